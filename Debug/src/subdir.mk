@@ -4,22 +4,85 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../src/accel.c \
+../src/boot.c \
+../src/canvas.c \
+../src/command.c \
 ../src/cr_startup_lpc17.c \
+../src/crash.c \
+../src/debounce.c \
+../src/fixed.c \
+../src/flashlog.c \
+../src/fmt.c \
+../src/iap.c \
+../src/joyinput.c \
+../src/ledbar.c \
 ../src/main.c \
+../src/params.c \
+../src/pinmux.c \
 ../src/rgbfixed.c \
-../src/task.c 
+../src/seg7.c \
+../src/sensors.c \
+../src/song.c \
+../src/synth.c \
+../src/task.c \
+../src/tempsense.c \
+../src/terminal.c \
+../src/watchdog.c 
 
 OBJS += \
+./src/accel.o \
+./src/boot.o \
+./src/canvas.o \
+./src/command.o \
 ./src/cr_startup_lpc17.o \
+./src/crash.o \
+./src/debounce.o \
+./src/fixed.o \
+./src/flashlog.o \
+./src/fmt.o \
+./src/iap.o \
+./src/joyinput.o \
+./src/ledbar.o \
 ./src/main.o \
+./src/params.o \
+./src/pinmux.o \
 ./src/rgbfixed.o \
-./src/task.o 
+./src/seg7.o \
+./src/sensors.o \
+./src/song.o \
+./src/synth.o \
+./src/task.o \
+./src/tempsense.o \
+./src/terminal.o \
+./src/watchdog.o 
 
 C_DEPS += \
+./src/accel.d \
+./src/boot.d \
+./src/canvas.d \
+./src/command.d \
 ./src/cr_startup_lpc17.d \
+./src/crash.d \
+./src/debounce.d \
+./src/fixed.d \
+./src/flashlog.d \
+./src/fmt.d \
+./src/iap.d \
+./src/joyinput.d \
+./src/ledbar.d \
 ./src/main.d \
+./src/params.d \
+./src/pinmux.d \
 ./src/rgbfixed.d \
-./src/task.d 
+./src/seg7.d \
+./src/sensors.d \
+./src/song.d \
+./src/synth.d \
+./src/task.d \
+./src/tempsense.d \
+./src/terminal.d \
+./src/watchdog.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -0,0 +1,233 @@
+/*****************************************************************************
+ * Accelerometer service functions
+ *
+ * Reads all three axes of the MMA7455 in one I2C burst at a fixed rate. Each
+ * sample is checked for motion, taps and free fall against a rest position
+ * that is calibrated continuously while the board is still. Only events and a summary of the samples since the last
+ * report are passed on, so callers do not need to look at every sample.
+ *
+ * The MMA7455 has no FIFO, so the burst read is of the three 8 bit output
+ * registers, which sit next to each other.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "accel.h"
+#include "fixed.h"
+
+#include "LPC17xx.h"
+#include "lpc17xx_i2c.h"
+#include "acc.h"
+
+#define ACC_I2C_ADDR 0x1D
+#define ACC_REG_XOUT8 0x06 // YOUT8 and ZOUT8 follow
+#define ACC_REG_CTL1 0x18
+#define ACC_CTL1_DFBW 0x80
+
+static FixedEma restX, restY, restZ; // Rest position, unprimed until the first sample
+static AccelSample lastSample;
+static uint8_t motionCount = 0;
+static uint8_t freefallCount = 0;
+static uint8_t tapHoldoff = 0;
+static int isMoving = 0;
+static int isFalling = 0;
+static volatile uint8_t events = 0;
+static int32_t sumX = 0, sumY = 0, sumZ = 0;
+static uint8_t peak = 0;
+static uint16_t summaryCount = 0;
+
+// ########################################################################################
+// Returns absolute value
+// ########################################################################################
+static int absolute(int value) {
+	return (value < 0) ? -value : value;
+}
+
+// ########################################################################################
+// Reads count registers starting at reg in one I2C transfer
+// ########################################################################################
+static int readRegisters(uint8_t reg, uint8_t *data, int count) {
+	I2C_M_SETUP_Type setup;
+
+	setup.sl_addr7bit = ACC_I2C_ADDR;
+	setup.tx_data = &reg;
+	setup.tx_length = 1;
+	setup.rx_data = data;
+	setup.rx_length = count;
+	setup.retransmissions_max = 3;
+
+	return I2C_MasterTransferData(LPC_I2C2, &setup, I2C_TRANSFER_POLLING) == SUCCESS;
+}
+
+// ########################################################################################
+// Writes a register
+// ########################################################################################
+static void writeRegister(uint8_t reg, uint8_t value) {
+	I2C_M_SETUP_Type setup;
+	uint8_t data[2];
+
+	data[0] = reg;
+	data[1] = value;
+	setup.sl_addr7bit = ACC_I2C_ADDR;
+	setup.tx_data = data;
+	setup.tx_length = 2;
+	setup.rx_data = 0;
+	setup.rx_length = 0;
+	setup.retransmissions_max = 3;
+
+	I2C_MasterTransferData(LPC_I2C2, &setup, I2C_TRANSFER_POLLING);
+}
+
+// ########################################################################################
+// Moves the rest position towards a sample
+// ########################################################################################
+static void calibrate(AccelSample *sample) {
+	fixed_emaUpdate(&restX, sample->x);
+	fixed_emaUpdate(&restY, sample->y);
+	fixed_emaUpdate(&restZ, sample->z);
+}
+
+// ########################################################################################
+// Checks a sample for motion, taps and free fall
+// ########################################################################################
+static void detectEvents(AccelSample *sample) {
+	int distance, jerk;
+
+	distance = absolute(sample->x - fixed_emaValue(&restX))
+			+ absolute(sample->y - fixed_emaValue(&restY))
+			+ absolute(sample->z - fixed_emaValue(&restZ));
+	if (distance > peak)
+		peak = (distance > 255) ? 255 : distance;
+
+	// Motion: far from rest for a number of samples. Only still samples calibrate.
+	if (distance > ACCEL_MOTION_THRESHOLD) {
+		if (motionCount < ACCEL_MOTION_SAMPLES && ++motionCount == ACCEL_MOTION_SAMPLES && !isMoving) {
+			events |= ACCEL_EVENT_MOTION;
+			isMoving = 1;
+		}
+	} else {
+		motionCount = 0;
+		isMoving = 0;
+		calibrate(sample);
+	}
+
+	// Tap: a sharp change on any axis that is over before it counts as motion
+	jerk = absolute(sample->x - lastSample.x);
+	if (absolute(sample->y - lastSample.y) > jerk)
+		jerk = absolute(sample->y - lastSample.y);
+	if (absolute(sample->z - lastSample.z) > jerk)
+		jerk = absolute(sample->z - lastSample.z);
+	if (tapHoldoff > 0) {
+		tapHoldoff--;
+	} else if (jerk > ACCEL_TAP_THRESHOLD && !isMoving) {
+		events |= ACCEL_EVENT_TAP;
+		tapHoldoff = ACCEL_TAP_HOLDOFF;
+	}
+
+	// Free fall: all axes read close to 0g
+	if (absolute(sample->x) < ACCEL_FREEFALL_THRESHOLD && absolute(sample->y) < ACCEL_FREEFALL_THRESHOLD
+			&& absolute(sample->z) < ACCEL_FREEFALL_THRESHOLD) {
+		if (freefallCount < ACCEL_FREEFALL_SAMPLES && ++freefallCount == ACCEL_FREEFALL_SAMPLES && !isFalling) {
+			events |= ACCEL_EVENT_FREEFALL;
+			isFalling = 1;
+		}
+	} else {
+		freefallCount = 0;
+		isFalling = 0;
+	}
+}
+
+// ########################################################################################
+// Puts the accelerometer in measurement mode and takes the first rest position
+// ########################################################################################
+void accel_init() {
+	acc_init();
+	accel_setDataRate(ACCEL_RATE_125HZ);
+	fixed_emaInit(&restX, ACCEL_CALIBRATION_SHIFT);
+	fixed_emaInit(&restY, ACCEL_CALIBRATION_SHIFT);
+	fixed_emaInit(&restZ, ACCEL_CALIBRATION_SHIFT);
+	events = 0;
+	// Takes the rest position if the read works, otherwise the first sample that does
+	accel_sample();
+}
+
+// ########################################################################################
+// Sets the output data rate of the accelerometer
+// ########################################################################################
+void accel_setDataRate(uint8_t rate) {
+	uint8_t ctl1;
+
+	if (!readRegisters(ACC_REG_CTL1, &ctl1, 1))
+		return;
+	if (rate == ACCEL_RATE_250HZ)
+		ctl1 |= ACC_CTL1_DFBW;
+	else
+		ctl1 &= ~ACC_CTL1_DFBW;
+	writeRegister(ACC_REG_CTL1, ctl1);
+}
+
+// ########################################################################################
+// Reads one sample and checks it for events; run every ACCEL_SAMPLE_TIME
+// ########################################################################################
+void accel_sample() {
+	uint8_t data[3];
+	AccelSample sample;
+
+	// A failed read is skipped, it does not count as a sample of 0g
+	if (!readRegisters(ACC_REG_XOUT8, data, 3))
+		return;
+
+	sample.x = (int8_t)data[0];
+	sample.y = (int8_t)data[1];
+	sample.z = (int8_t)data[2];
+
+	// First good sample is the rest position and nothing to compare taps with
+	if (!restX.isPrimed) {
+		calibrate(&sample);
+		lastSample = sample;
+	}
+	detectEvents(&sample);
+	lastSample = sample;
+
+	sumX += sample.x;
+	sumY += sample.y;
+	sumZ += sample.z;
+	summaryCount++;
+}
+
+// ########################################################################################
+// Returns ACCEL_EVENT_* bits seen since the last call
+// ########################################################################################
+uint8_t accel_getEvents() {
+	uint8_t seen;
+
+	__disable_irq();
+	seen = events;
+	events = 0;
+	__enable_irq();
+	return seen;
+}
+
+// ########################################################################################
+// Gets the mean of the samples since the last summary and starts a new one
+// ########################################################################################
+void accel_getSummary(AccelSummary *summary) {
+	if (summaryCount == 0) {
+		summary->x = lastSample.x;
+		summary->y = lastSample.y;
+		summary->z = lastSample.z - fixed_emaValue(&restZ);
+	} else {
+		summary->x = fixed_divRound(sumX, summaryCount);
+		summary->y = fixed_divRound(sumY, summaryCount);
+		summary->z = fixed_divRound(sumZ, summaryCount) - fixed_emaValue(&restZ);
+	}
+	summary->peak = peak;
+	summary->sampleCount = summaryCount;
+
+	sumX = sumY = sumZ = 0;
+	peak = 0;
+	summaryCount = 0;
+}
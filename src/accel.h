@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * Accelerometer service header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef ACCEL_H_
+#define ACCEL_H_
+
+#include <stdint.h>
+
+#define ACCEL_SAMPLE_TIME 10 // Accelerometer is read every ACCEL_SAMPLE_TIME ms
+
+// Output data rate of the MMA7455, set with accel_setDataRate
+#define ACCEL_RATE_125HZ 0 // 62.5 Hz filter bandwidth
+#define ACCEL_RATE_250HZ 1 // 125 Hz filter bandwidth
+
+// Events, returned as bits by accel_getEvents
+#define ACCEL_EVENT_MOTION 0x01
+#define ACCEL_EVENT_TAP 0x02
+#define ACCEL_EVENT_FREEFALL 0x04
+
+// Thresholds in counts, 64 counts per g in the 2g range
+#define ACCEL_MOTION_THRESHOLD 12 // Sum of all axes away from rest
+#define ACCEL_MOTION_SAMPLES 5 // Samples in a row above threshold for motion
+#define ACCEL_TAP_THRESHOLD 40 // Change on one axis between two samples
+#define ACCEL_TAP_HOLDOFF 20 // Samples ignored after a tap
+#define ACCEL_FREEFALL_THRESHOLD 16 // Every axis below this is about 0g
+#define ACCEL_FREEFALL_SAMPLES 8
+#define ACCEL_CALIBRATION_SHIFT 6 // Rest position moves by 1/64 of the difference per still sample
+
+typedef struct AccelSample
+{
+	int8_t x;
+	int8_t y;
+	int8_t z;
+} AccelSample;
+
+typedef struct AccelSummary
+{
+	int8_t x; // Mean since the last summary
+	int8_t y;
+	int8_t z; // Relative to the calibrated rest position
+	uint8_t peak; // Largest distance from rest, sum of all axes
+	uint16_t sampleCount;
+} AccelSummary;
+
+void accel_init();
+
+void accel_setDataRate(uint8_t rate);
+
+void accel_sample();
+
+uint8_t accel_getEvents();
+
+void accel_getSummary(AccelSummary *summary);
+
+#endif /* ACCEL_H_ */
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Boot checkpoint functions
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "boot.h"
+
+#include "LPC17xx.h"
+
+// Debug trace registers; not in this version of core_cm3.h
+#define DEMCR (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA (1<<24)
+#define DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA (1<<0)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+static uint32_t cycles[BOOT_CHECKPOINTS]; // 0 until reached; the counter is past 0 by then
+
+// ########################################################################################
+// Starts the cycle counter from 0. Called first thing in ResetISR, so no globals yet.
+// ########################################################################################
+void boot_startCycleCounter() {
+	DEMCR |= DEMCR_TRCENA;
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+// ########################################################################################
+// Records the first time a checkpoint is reached
+// ########################################################################################
+void boot_checkpoint(BootCheckpoint checkpoint) {
+	if (cycles[checkpoint] == 0)
+		cycles[checkpoint] = DWT_CYCCNT;
+}
+
+// ########################################################################################
+// Returns microseconds from reset to a checkpoint, or BOOT_NOT_REACHED
+// ########################################################################################
+uint32_t boot_getMicros(BootCheckpoint checkpoint) {
+	uint32_t slowCycles = cycles[BOOT_CLOCK];
+
+	if (cycles[checkpoint] == 0)
+		return BOOT_NOT_REACHED;
+	// Cycles up to SystemInit ran from the IRC, the rest from SystemCoreClock
+	if (checkpoint <= BOOT_CLOCK)
+		return cycles[checkpoint]/(BOOT_IRC_HZ/1000000);
+	return slowCycles/(BOOT_IRC_HZ/1000000) + (cycles[checkpoint]-slowCycles)/(SystemCoreClock/1000000);
+}
+
+// ########################################################################################
+// Returns the cycle counter, for timing code on the bench
+// ########################################################################################
+uint32_t boot_getCycleCount() {
+	return DWT_CYCCNT;
+}
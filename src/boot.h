@@ -0,0 +1,40 @@
+/*****************************************************************************
+ * Boot checkpoint header file
+ * (times boot with the DWT cycle counter, which starts at reset)
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+
+#define BOOT_IRC_HZ 4000000 // Core clock before SystemInit switches to the PLL
+#define BOOT_NOT_REACHED 0xFFFFFFFF
+
+// In the order they are reached. The counter wraps after about 42 s at
+// 100 MHz, so checkpoints reached later than that read wrong.
+typedef enum BootCheckpoint
+{
+	BOOT_MEMORY,    // .data and .bss set up
+	BOOT_CLOCK,     // SystemInit done, running from the PLL
+	BOOT_CORE,      // GPIO, buses, UART, timers and commands ready
+	BOOT_MODE,      // Devices for the first mode up and the mode started
+	BOOT_DEVICES,   // Every device brought up
+	BOOT_TELEMETRY, // First sensor report sent
+	BOOT_CHECKPOINTS
+} BootCheckpoint;
+
+void boot_startCycleCounter();
+
+void boot_checkpoint(BootCheckpoint checkpoint);
+
+uint32_t boot_getMicros(BootCheckpoint checkpoint);
+
+uint32_t boot_getCycleCount();
+
+#endif /* BOOT_H_ */
@@ -0,0 +1,235 @@
+/*****************************************************************************
+ * Canvas functions
+ *
+ * Keeps the collaborative canvas as a 1 bit per pixel bitmap together with a
+ * run-length encoded log of pen strokes, so that the drawing survives leaving
+ * canvas mode and can be redrawn on the OLED or the terminal in one go.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "canvas.h"
+#include <stddef.h>
+#include "mem.h"
+#include "terminal.h"
+
+#include "oled.h"
+
+#define EXPORT_LINE_LENGTH 64
+#define EXPORT_MAX_RUN 63 // Runs are sent as '0'+length
+
+static uint8_t bitmap[CANVAS_HEIGHT][CANVAS_WIDTH/8] MEM_AHB_BSS;
+static uint8_t strokeLog[CANVAS_LOG_SIZE] MEM_AHB_BSS;
+static int strokeLogLength = 0;
+static int hasLogOverflowed = 0;
+static uint8_t startX = CANVAS_WIDTH/2; // Pen position when the log starts
+static uint8_t startY = CANVAS_HEIGHT/2;
+static uint8_t currX = CANVAS_WIDTH/2;
+static uint8_t currY = CANVAS_HEIGHT/2;
+static const int8_t stepX[4] = {0, 0, -1, 1};
+static const int8_t stepY[4] = {-1, 1, 0, 0};
+static void (*onBusy)() = NULL; // Set by canvas_setBusyHook
+
+// ########################################################################################
+// Returns 1 if pixel is set in bitmap
+// ########################################################################################
+static int isPixelSet(uint8_t x, uint8_t y) {
+	return (bitmap[y][x>>3] >> (x&7)) & 1;
+}
+
+// ########################################################################################
+// Sets pixel in bitmap
+// ########################################################################################
+static void setPixel(uint8_t x, uint8_t y) {
+	bitmap[y][x>>3] |= 1 << (x&7);
+}
+
+// ########################################################################################
+// Adds a step to the stroke log, extending the last run if possible
+// ########################################################################################
+static void logStep(uint8_t direction, int isDrawing) {
+	uint8_t entry = (direction << 6) | (isDrawing ? CANVAS_LOG_PEN : 0);
+
+	if (strokeLogLength > 0) {
+		uint8_t *last = &strokeLog[strokeLogLength-1];
+		if ((*last & 0xE0) == entry && (*last & 0x1F) < CANVAS_LOG_MAX_RUN-1) {
+			(*last)++;
+			return;
+		}
+	}
+	if (strokeLogLength < CANVAS_LOG_SIZE) {
+		strokeLog[strokeLogLength++] = entry;
+	} else {
+		hasLogOverflowed = 1; // Bitmap is still complete
+	}
+}
+
+// ########################################################################################
+// Draw at the pen on teraterm and move the cursor to x, y
+// ########################################################################################
+static void moveTerminalCursor(uint8_t x, uint8_t y, uint8_t direction, int isDrawing) {
+	if (isDrawing) {
+		term_moveTo(x+1, y+1);
+		term_putChar((direction == CANVAS_LEFT || direction == CANVAS_RIGHT) ? '-' : '|');
+	}
+	term_moveTo(x+stepX[direction]+1, y+stepY[direction]+1);
+}
+
+// ########################################################################################
+// Clears the canvas and moves the pen back to the center
+// ########################################################################################
+void canvas_reset() {
+	int y, i;
+	for (y=0;y<CANVAS_HEIGHT;y++) {
+		for (i=0;i<CANVAS_WIDTH/8;i++) {
+			bitmap[y][i] = 0;
+		}
+	}
+	strokeLogLength = 0;
+	hasLogOverflowed = 0;
+	currX = startX = CANVAS_WIDTH/2;
+	currY = startY = CANVAS_HEIGHT/2;
+}
+
+// ########################################################################################
+// Moves the pen one pixel, drawing on the bitmap, OLED and teraterm
+// ########################################################################################
+void canvas_step(uint8_t direction, int isDrawing) {
+	int newX = currX+stepX[direction];
+	int newY = currY+stepY[direction];
+
+	if (newX < 0 || newX >= CANVAS_WIDTH || newY < 0 || newY >= CANVAS_HEIGHT)
+		return;
+
+	moveTerminalCursor(currX, currY, direction, isDrawing);
+	logStep(direction, isDrawing);
+
+	if (isDrawing) {
+		setPixel(currX, currY);
+		setPixel(newX, newY);
+	}
+
+	// Pen is always shown, old position is only cleared if nothing was drawn there
+	oled_putPixel(newX, newY, OLED_COLOR_WHITE);
+	if (!isPixelSet(currX, currY)) {
+		oled_putPixel(currX, currY, OLED_COLOR_BLACK);
+	}
+	currX = newX;
+	currY = newY;
+}
+
+// ########################################################################################
+// Tells whoever is interested that a long redraw or export is still going
+// ########################################################################################
+static void busy() {
+	if (onBusy != NULL)
+		onBusy();
+}
+
+// ########################################################################################
+// Sets a function called every row or log entry of a redraw or export, which can take
+// seconds over the UART
+// ########################################################################################
+void canvas_setBusyHook(void (*hook)()) {
+	onBusy = hook;
+}
+
+// ########################################################################################
+// Redraws the canvas on the OLED a row at a time, one line per run of set pixels
+// ########################################################################################
+void canvas_replayOled() {
+	int x, y, runStart;
+
+	oled_clearScreen(OLED_COLOR_BLACK);
+	for (y=0;y<CANVAS_HEIGHT;y++) {
+		busy();
+		runStart = -1;
+		for (x=0;x<=CANVAS_WIDTH;x++) {
+			if (x < CANVAS_WIDTH && isPixelSet(x, y)) {
+				if (runStart < 0)
+					runStart = x;
+			} else if (runStart >= 0) {
+				oled_line(runStart, y, x-1, y, OLED_COLOR_WHITE);
+				runStart = -1;
+			}
+		}
+	}
+	oled_putPixel(currX, currY, OLED_COLOR_WHITE);
+}
+
+// ########################################################################################
+// Redraws the canvas on teraterm in one burst by replaying the stroke log
+// ########################################################################################
+void canvas_replayTerminal() {
+	int entry, run;
+	uint8_t x, y, direction;
+
+	if (hasLogOverflowed) {
+		// Log is incomplete, draw the bitmap instead
+		for (y=0;y<CANVAS_HEIGHT;y++) {
+			busy();
+			for (x=0;x<CANVAS_WIDTH;x++) {
+				if (isPixelSet(x, y)) {
+					term_moveTo(x+1, y+1);
+					term_putChar('#');
+				}
+			}
+		}
+		term_moveTo(currX+1, currY+1);
+		term_flush();
+		return;
+	}
+
+	x = startX;
+	y = startY;
+	for (entry=0;entry<strokeLogLength;entry++) {
+		busy();
+		direction = strokeLog[entry] >> 6;
+		for (run=0;run<=(strokeLog[entry] & 0x1F);run++) {
+			moveTerminalCursor(x, y, direction, strokeLog[entry] & CANVAS_LOG_PEN);
+			x += stepX[direction];
+			y += stepY[direction];
+		}
+	}
+	term_moveTo(x+1, y+1);
+	term_flush();
+}
+
+// ########################################################################################
+// Sends the bitmap to home as alternating runs of clear and set pixels
+// ########################################################################################
+void canvas_export() {
+	char line[EXPORT_LINE_LENGTH+3];
+	int lineLength = 0;
+	int x, y, run = 0, runValue = 0;
+
+	term_write("CANVAS 96x64 RLE\r\n");
+	for (y=0;y<=CANVAS_HEIGHT;y++) {
+		busy();
+		for (x=0;x<CANVAS_WIDTH;x++) {
+			// Flush the last run after the final pixel
+			int isEnd = (y == CANVAS_HEIGHT);
+			if (isEnd || isPixelSet(x, y) != runValue || run == EXPORT_MAX_RUN) {
+				line[lineLength++] = '0'+run;
+				if (!isEnd && isPixelSet(x, y) == runValue) {
+					line[lineLength++] = '0'; // Empty run of the other value
+				}
+				if (lineLength >= EXPORT_LINE_LENGTH-1 || isEnd) {
+					line[lineLength++] = '\r';
+					line[lineLength++] = '\n';
+					line[lineLength] = '\0';
+					term_write(line);
+					lineLength = 0;
+				}
+				if (isEnd)
+					return;
+				runValue = isPixelSet(x, y);
+				run = 0;
+			}
+			run++;
+		}
+	}
+}
@@ -0,0 +1,41 @@
+/*****************************************************************************
+ * Canvas header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef CANVAS_H_
+#define CANVAS_H_
+
+#include <stdint.h>
+
+#define CANVAS_WIDTH 96
+#define CANVAS_HEIGHT 64
+#define CANVAS_LOG_SIZE 512
+
+// Directions of a stroke
+#define CANVAS_UP 0
+#define CANVAS_DOWN 1
+#define CANVAS_LEFT 2
+#define CANVAS_RIGHT 3
+
+// Stroke log entry: direction in bits 7-6, pen down in bit 5, run length-1 in bits 4-0
+#define CANVAS_LOG_PEN 0x20
+#define CANVAS_LOG_MAX_RUN 32
+
+void canvas_reset();
+
+void canvas_step(uint8_t direction, int isDrawing);
+
+void canvas_replayOled();
+
+void canvas_replayTerminal();
+
+void canvas_export();
+
+void canvas_setBusyHook(void (*hook)());
+
+#endif /* CANVAS_H_ */
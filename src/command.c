@@ -0,0 +1,208 @@
+/*****************************************************************************
+ * Command protocol functions
+ *
+ * Lets a host drive the board with framed commands instead of the keystroke
+ * menus. The UART interrupt feeds every character to a small state machine
+ * that picks out frames and queues them; the main loop runs the queued
+ * commands in order and acknowledges each one with its id, so a host can
+ * send several commands without waiting for each answer. Frames do not go
+ * through the keystroke debounce.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "command.h"
+#include "mem.h"
+#include "terminal.h"
+#include "fmt.h"
+#include <string.h>
+
+#define MAX_ID 65535
+
+// Parser states
+#define STATE_IDLE 0
+#define STATE_ID 1
+#define STATE_BODY 2
+
+typedef struct Frame
+{
+	uint16_t id;
+	uint8_t isTooLong;
+	char line[CMD_MAX_LENGTH+1];
+} Frame;
+
+static const Command *commandTable;
+static int commandTableLength = 0;
+static Frame queue[CMD_QUEUE_LENGTH] MEM_AHB_BSS;
+static volatile uint8_t head = 0; // Frame being received
+static volatile uint8_t tail = 0; // Next frame to run
+static volatile int isDropping = 0; // Queue was full when the current frame started
+static volatile int droppedId = -1; // Last frame dropped because the queue was full
+static uint8_t state = STATE_IDLE;
+static uint8_t isAfterCR = 0; // Last frame ended on '\r', so a '\n' straight after is part of it
+static uint32_t id = 0;
+static int lineLength = 0;
+static uint32_t receivedCount = 0;
+static uint32_t errorCount = 0;
+
+// ########################################################################################
+// Sends the answer to a frame
+// ########################################################################################
+static void sendReply(uint16_t frameId, int result, char *data) {
+	char reply[CMD_REPLY_SIZE+16], *end;
+
+	if (result != CMD_OK)
+		errorCount++;
+	end = fmt_uint(fmt_char(reply, CMD_REPLY), frameId);
+	end = fmt_str(end, (result == CMD_OK) ? " OK" : " ERR");
+	if (data[0] != '\0')
+		end = fmt_str(fmt_char(end, ' '), data);
+	fmt_str(end, "\r\n");
+	term_write(reply);
+}
+
+// ########################################################################################
+// Finds and runs the command in a frame
+// ########################################################################################
+static void runFrame(Frame *frame) {
+	char data[CMD_REPLY_SIZE];
+	char *args;
+	int i, result;
+
+	data[0] = '\0';
+	if (frame->isTooLong) {
+		sendReply(frame->id, CMD_ERR, "TOO_LONG");
+		return;
+	}
+
+	// Split name from arguments
+	args = strchr(frame->line, ' ');
+	if (args != NULL) {
+		*args++ = '\0';
+	} else {
+		args = frame->line+strlen(frame->line);
+	}
+
+	for (i=0;i<commandTableLength;i++) {
+		if (strcmp(frame->line, commandTable[i].name) == 0) {
+			result = commandTable[i].handler(args, data);
+			sendReply(frame->id, result, data);
+			return;
+		}
+	}
+	sendReply(frame->id, CMD_ERR, "UNKNOWN");
+}
+
+// ########################################################################################
+// Sets the commands the protocol understands
+// ########################################################################################
+void cmd_init(const Command *commands, int commandCount) {
+	commandTable = commands;
+	commandTableLength = commandCount;
+	state = STATE_IDLE;
+	isAfterCR = 0;
+	head = tail = 0;
+}
+
+// ########################################################################################
+// Interrupt: feeds a received character to the parser. Returns 1 if it was part of a frame.
+// ########################################################################################
+int cmd_receive(uint8_t ch) {
+	Frame *frame = &queue[head % CMD_QUEUE_LENGTH];
+
+	// CRLF ends a frame once; the '\n' must not reach the keystroke menus
+	if (isAfterCR) {
+		isAfterCR = 0;
+		if (ch == '\n')
+			return 1;
+	}
+
+	switch (state) {
+		case STATE_IDLE:
+			if (ch != CMD_START)
+				return 0;
+			state = STATE_ID;
+			id = 0;
+			lineLength = 0;
+			isDropping = ((uint8_t)(head-tail) >= CMD_QUEUE_LENGTH);
+			return 1;
+		case STATE_ID:
+			if (ch >= '0' && ch <= '9' && id*10+(ch-'0') <= MAX_ID) {
+				id = id*10+(ch-'0');
+				return 1;
+			}
+			if (ch != ' ' && ch != '\r' && ch != '\n') {
+				// Not a frame after all
+				state = STATE_IDLE;
+				errorCount++;
+				return 1;
+			}
+			state = STATE_BODY;
+			if (!isDropping) {
+				frame->id = id;
+				frame->isTooLong = 0;
+			}
+			if (ch == ' ')
+				return 1;
+			// Empty frame, end it below
+			break;
+		case STATE_BODY:
+			break;
+		default:
+			state = STATE_IDLE;
+			return 0;
+	}
+
+	if (ch == '\r' || ch == '\n') {
+		state = STATE_IDLE;
+		isAfterCR = (ch == '\r');
+		receivedCount++;
+		if (isDropping) {
+			droppedId = id;
+		} else {
+			frame->line[lineLength] = '\0';
+			head++;
+		}
+	} else if (!isDropping) {
+		if (lineLength < CMD_MAX_LENGTH)
+			frame->line[lineLength++] = ch;
+		else
+			frame->isTooLong = 1;
+	}
+	return 1;
+}
+
+// ########################################################################################
+// Runs queued commands; run from the main loop
+// ########################################################################################
+void cmd_poll() {
+	int dropped;
+
+	while (tail != head) {
+		runFrame(&queue[tail % CMD_QUEUE_LENGTH]);
+		tail++;
+	}
+
+	dropped = droppedId;
+	if (dropped >= 0) {
+		droppedId = -1;
+		sendReply(dropped, CMD_ERR, "BUSY");
+	}
+}
+
+// ########################################################################################
+// Returns number of frames received
+// ########################################################################################
+uint32_t cmd_getReceivedCount() {
+	return receivedCount;
+}
+
+// ########################################################################################
+// Returns number of frames that were malformed or answered with ERR
+// ########################################################################################
+uint32_t cmd_getErrorCount() {
+	return errorCount;
+}
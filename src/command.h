@@ -0,0 +1,41 @@
+/*****************************************************************************
+ * Command protocol header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+
+// Frames are #<id> <NAME> [args]<CR>, answered with !<id> OK [data] or !<id> ERR <reason>
+#define CMD_START '#'
+#define CMD_REPLY '!'
+#define CMD_MAX_LENGTH 40 // Characters after the id
+#define CMD_REPLY_SIZE 96
+#define CMD_QUEUE_LENGTH 4 // Commands that can be sent before the first is answered
+
+#define CMD_OK 0
+#define CMD_ERR 1
+
+typedef struct Command
+{
+	const char *name;
+	int (*handler)(char *args, char *reply); // Returns CMD_OK or CMD_ERR with reason in reply
+} Command;
+
+void cmd_init(const Command *commands, int commandCount);
+
+int cmd_receive(uint8_t ch);
+
+void cmd_poll();
+
+uint32_t cmd_getReceivedCount();
+
+uint32_t cmd_getErrorCount();
+
+#endif /* COMMAND_H_ */
@@ -49,6 +49,11 @@ extern "C" {
 #include "system_LPC17xx.h"
 #endif
 
+// Boot checkpoints are recorded while the runtime is set up
+#include "boot.h"
+// Fault handlers hand over to the crash dump code
+#include "crash.h"
+
 //*****************************************************************************
 #if defined (__cplusplus)
 extern "C" {
@@ -146,7 +151,8 @@ extern void _vStackTop(void);
 //
 //*****************************************************************************
 extern void (* const g_pfnVectors[])(void);
-__attribute__ ((section(".isr_vector")))
+// "used" stops link time optimisation dropping it; only the linker script refers to it
+__attribute__ ((used, section(".isr_vector")))
 void (* const g_pfnVectors[])(void) = {
 	// Core Level - CM3
 	&_vStackTop, // The initial stack pointer
@@ -217,6 +223,67 @@ extern unsigned long _edata;
 extern unsigned long _bss;
 extern unsigned long _ebss;
 
+//*****************************************************************************
+//
+// The section tables list every "data" and "bss" section, including the ones
+// placed in RamAHB32, so both banks are set up the same way.
+//
+//*****************************************************************************
+extern unsigned int __data_section_table;
+extern unsigned int __data_section_table_end;
+extern unsigned int __bss_section_table;
+extern unsigned int __bss_section_table_end;
+
+//*****************************************************************************
+// Copies one "data" section from its load address in flash to RAM, four words
+// per ldm/stm pair and then any words left over one at a time. The linker
+// script keeps every section start and length a multiple of 4.
+//*****************************************************************************
+__attribute__ ((section(".after_vectors")))
+void data_init(unsigned int romstart, unsigned int start, unsigned int len) {
+	unsigned int *pulDest = (unsigned int*) start;
+	unsigned int *pulSrc = (unsigned int*) romstart;
+	unsigned int *pulEnd = (unsigned int*) (start + len);
+
+	__asm volatile("1:  sub     r3, %[end], %[dest]\n"
+	               "    cmp     r3, #16\n"
+	               "    blt     2f\n"
+	               "    ldmia   %[src]!, {r3-r6}\n"
+	               "    stmia   %[dest]!, {r3-r6}\n"
+	               "    b       1b\n"
+	               "2:\n"
+	               : [dest] "+r" (pulDest), [src] "+r" (pulSrc)
+	               : [end] "r" (pulEnd)
+	               : "r3", "r4", "r5", "r6", "cc", "memory");
+	while (pulDest < pulEnd)
+		*pulDest++ = *pulSrc++;
+}
+
+//*****************************************************************************
+// Zero fills one "bss" section, four words per stm and then one at a time
+//*****************************************************************************
+__attribute__ ((section(".after_vectors")))
+void bss_init(unsigned int start, unsigned int len) {
+	unsigned int *pulDest = (unsigned int*) start;
+	unsigned int *pulEnd = (unsigned int*) (start + len);
+
+	__asm volatile("    mov     r3, #0\n"
+	               "    mov     r4, #0\n"
+	               "    mov     r5, #0\n"
+	               "    mov     r6, #0\n"
+	               "1:  sub     r2, %[end], %[dest]\n"
+	               "    cmp     r2, #16\n"
+	               "    blt     2f\n"
+	               "    stmia   %[dest]!, {r3-r6}\n"
+	               "    b       1b\n"
+	               "2:\n"
+	               : [dest] "+r" (pulDest)
+	               : [end] "r" (pulEnd)
+	               : "r2", "r3", "r4", "r5", "r6", "cc", "memory");
+	while (pulDest < pulEnd)
+		*pulDest++ = 0;
+}
+
 //*****************************************************************************
 // Reset entry point for your code.
 // Sets up a simple runtime environment and initializes the C/C++
@@ -225,34 +292,39 @@ extern unsigned long _ebss;
 //*****************************************************************************
 void
 ResetISR(void) {
-    unsigned long *pulSrc, *pulDest;
+    unsigned int LoadAddr, ExeAddr, SectionLen;
+    unsigned int *SectionTableAddr;
 
     //
-    // Copy the data segment initializers from flash to SRAM.
+    // Count cycles from here so boot checkpoints can be timed.
     //
-    pulSrc = &_etext;
-    for(pulDest = &_data; pulDest < &_edata; )
-    {
-        *pulDest++ = *pulSrc++;
+    boot_startCycleCounter();
+
+    //
+    // Copy the data sections from flash to SRAM, one table entry at a time.
+    //
+    SectionTableAddr = &__data_section_table;
+    while (SectionTableAddr < &__data_section_table_end) {
+        LoadAddr = *SectionTableAddr++;
+        ExeAddr = *SectionTableAddr++;
+        SectionLen = *SectionTableAddr++;
+        data_init(LoadAddr, ExeAddr, SectionLen);
     }
 
     //
-    // Zero fill the bss segment.  This is done with inline assembly since this
-    // will clear the value of pulDest if it is not kept in a register.
+    // Zero fill the bss sections.
     //
-    __asm("    ldr     r0, =_bss\n"
-          "    ldr     r1, =_ebss\n"
-          "    mov     r2, #0\n"
-          "    .thumb_func\n"
-          "zero_loop:\n"
-          "        cmp     r0, r1\n"
-          "        it      lt\n"
-          "        strlt   r2, [r0], #4\n"
-          "        blt     zero_loop");
+    while (SectionTableAddr < &__bss_section_table_end) {
+        ExeAddr = *SectionTableAddr++;
+        SectionLen = *SectionTableAddr++;
+        bss_init(ExeAddr, SectionLen);
+    }
+    boot_checkpoint(BOOT_MEMORY);
 
 #ifdef __USE_CMSIS
 	SystemInit();
 #endif
+	boot_checkpoint(BOOT_CLOCK);
 
 #if defined (__cplusplus)
 	//
@@ -290,33 +362,32 @@ void NMI_Handler(void)
     }
 }
 
-void HardFault_Handler(void)
-{
-    while(1)
-    {
-    }
-}
-
-void MemManage_Handler(void)
-{
-    while(1)
-    {
-    }
-}
-
-void BusFault_Handler(void)
-{
-    while(1)
-    {
-    }
+//*****************************************************************************
+//
+// The fault handlers pass the exception frame, from whichever stack was in
+// use, to crash_capture, which saves a dump for the next boot and lets the
+// watchdog reset the chip.
+//
+//*****************************************************************************
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#define FAULT_HANDLER(name, type) \
+__attribute__ ((naked)) \
+void name(void) \
+{ \
+    __asm volatile("    tst     lr, #4\n" \
+                   "    ite     eq\n" \
+                   "    mrseq   r0, msp\n" \
+                   "    mrsne   r0, psp\n" \
+                   "    mov     r1, lr\n" \
+                   "    mov     r2, #" XSTR(type) "\n" \
+                   "    b       crash_capture\n"); \
 }
 
-void UsageFault_Handler(void)
-{
-    while(1)
-    {
-    }
-}
+FAULT_HANDLER(HardFault_Handler, CRASH_HARD_FAULT)
+FAULT_HANDLER(MemManage_Handler, CRASH_MEM_MANAGE)
+FAULT_HANDLER(BusFault_Handler, CRASH_BUS_FAULT)
+FAULT_HANDLER(UsageFault_Handler, CRASH_USAGE_FAULT)
 
 void SVCall_Handler(void)
 {
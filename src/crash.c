@@ -0,0 +1,135 @@
+/*****************************************************************************
+ * Crash dump functions
+ *
+ * The dump lives in .noinit, which ResetISR leaves alone, so it survives
+ * the watchdog reset. crash_init checks and moves it out on the next boot.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "crash.h"
+#include "mem.h"
+#include <stddef.h>
+#include <string.h>
+
+#include "LPC17xx.h"
+
+#define CRASH_MAGIC 0xC4A5D0C5
+#define RAM_START 0x10000000
+#define FRAME_WORDS 8 // r0-r3, r12, lr, pc, xpsr
+
+#define SHCSR_MEMFAULTENA (1<<16)
+#define SHCSR_BUSFAULTENA (1<<17)
+#define SHCSR_USGFAULTENA (1<<18)
+
+#define WDMOD_WDEN (1<<0)
+#define WDMOD_WDRESET (1<<1)
+#define WDT_MIN_TIMEOUT 0xFF // ~256 us from the 4 MHz IRC
+
+extern unsigned int _vStackTop;
+
+static CrashDump dump MEM_NOINIT;
+static CrashDump lastDump;
+static int hasLastDump = 0;
+
+// ########################################################################################
+// Adds up every word before the checksum
+// ########################################################################################
+static uint32_t checksum(const CrashDump *crash) {
+	const uint32_t *word = (const uint32_t *)crash;
+	uint32_t sum = 0;
+	while (word < &crash->checksum)
+		sum = (sum << 1 | sum >> 31) + *word++;
+	return sum;
+}
+
+// ########################################################################################
+// Picks up a dump left by the last run and gives the faults their own handlers
+// ########################################################################################
+void crash_init() {
+	if (dump.magic == CRASH_MAGIC && dump.checksum == checksum(&dump)) {
+		lastDump = dump;
+		hasLastDump = 1;
+	}
+	dump.magic = 0;
+
+	// Otherwise memory, bus and usage faults all arrive as hard faults
+	SCB->SHCSR |= SHCSR_MEMFAULTENA | SHCSR_BUSFAULTENA | SHCSR_USGFAULTENA;
+}
+
+// ########################################################################################
+// Returns the dump from before the last reset, or NULL if it didn't crash
+// ########################################################################################
+const CrashDump *crash_getLast() {
+	return hasLastDump ? &lastDump : NULL;
+}
+
+// ########################################################################################
+// Seals the dump and lets the watchdog reset the chip as soon as it can
+// ########################################################################################
+static void saveAndReset() __attribute__ ((noreturn));
+static void saveAndReset() {
+	dump.cfsr = SCB->CFSR;
+	dump.hfsr = SCB->HFSR;
+	dump.mmfar = SCB->MMFAR;
+	dump.bfar = SCB->BFAR;
+	dump.magic = CRASH_MAGIC;
+	dump.checksum = checksum(&dump);
+
+	LPC_WDT->WDCLKSEL = 0;
+	LPC_WDT->WDTC = WDT_MIN_TIMEOUT;
+	LPC_WDT->WDMOD = WDMOD_WDEN | WDMOD_WDRESET;
+	LPC_WDT->WDFEED = 0xAA;
+	LPC_WDT->WDFEED = 0x55;
+	while (1) {
+	}
+}
+
+// ########################################################################################
+// Called by the fault handlers with the exception frame. Saves the dump and resets.
+// Only the handlers' asm calls it, so "used" keeps it through link time optimisation.
+// ########################################################################################
+__attribute__ ((used))
+void crash_capture(uint32_t *frame, uint32_t excReturn, uint32_t type) {
+	int word;
+	uint32_t *stack;
+
+	dump.type = type;
+	dump.sp = (uint32_t)frame;
+	dump.excReturn = excReturn;
+	dump.task = CRASH_NO_TASK;
+
+	// A stack overflow leaves sp outside RAM, and reading there would fault again
+	dump.isFrameValid = ((uint32_t)frame & 3) == 0 && (uint32_t)frame >= RAM_START
+			&& frame+FRAME_WORDS <= (uint32_t *)&_vStackTop;
+	if (dump.isFrameValid) {
+		dump.r0 = frame[0];
+		dump.r1 = frame[1];
+		dump.r2 = frame[2];
+		dump.r3 = frame[3];
+		dump.r12 = frame[4];
+		dump.lr = frame[5];
+		dump.pc = frame[6];
+		dump.xpsr = frame[7];
+	} else {
+		dump.r0 = dump.r1 = dump.r2 = dump.r3 = dump.r12 = dump.lr = dump.pc = dump.xpsr = 0;
+	}
+	stack = frame+FRAME_WORDS;
+	for (word=0;word<CRASH_STACK_WORDS;word++) {
+		dump.stack[word] = (dump.isFrameValid && stack+word < (uint32_t *)&_vStackTop) ? stack[word] : 0;
+	}
+	saveAndReset();
+}
+
+// ########################################################################################
+// Called by the watchdog supervisor when a task is late. Saves which one and resets.
+// ########################################################################################
+void crash_watchdog(uint32_t task) {
+	memset(&dump, 0, sizeof(dump));
+	dump.type = CRASH_WATCHDOG;
+	dump.task = task;
+	saveAndReset();
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * Crash dump header file
+ * (fault handlers save the CPU state here, then the watchdog resets the unit)
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef CRASH_H_
+#define CRASH_H_
+
+#include <stdint.h>
+
+// Fault types; plain numbers so the handlers in cr_startup_lpc17.c can use them in asm
+#define CRASH_HARD_FAULT 1
+#define CRASH_MEM_MANAGE 2
+#define CRASH_BUS_FAULT 3
+#define CRASH_USAGE_FAULT 4
+#define CRASH_WATCHDOG 5 // A supervised task missed its deadline
+
+#define CRASH_NO_TASK 0xFFFFFFFF
+
+#define CRASH_STACK_WORDS 16 // Words kept from just above the exception frame
+
+typedef struct CrashDump
+{
+	uint32_t magic;
+	uint32_t type; // CRASH_HARD_FAULT etc.
+	uint32_t sp; // Stack pointer when the fault was taken
+	uint32_t excReturn; // LR on entry to the handler
+	uint32_t isFrameValid; // 0 if sp was outside RAM, so nothing was read from it
+	uint32_t r0, r1, r2, r3, r12, lr, pc, xpsr; // Stacked by the exception
+	uint32_t cfsr, hfsr, mmfar, bfar;
+	uint32_t stack[CRASH_STACK_WORDS];
+	uint32_t task; // Watchdog number of the late task, or CRASH_NO_TASK
+	uint32_t checksum;
+} CrashDump;
+
+void crash_init();
+
+const CrashDump *crash_getLast();
+
+void crash_capture(uint32_t *frame, uint32_t excReturn, uint32_t type) __attribute__ ((noreturn));
+
+void crash_watchdog(uint32_t task) __attribute__ ((noreturn));
+
+#endif /* CRASH_H_ */
@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * Debounce functions
+ *
+ * One engine for every noisy input, serviced once per tick. Level inputs
+ * (buttons) are polled and integrated: the count moves towards the threshold
+ * while the input is active and back to zero while it is not, and onPress is
+ * called when it reaches the threshold. Event inputs (UART keystrokes) report
+ * events through debounce_accept, which ignores further events for a number
+ * of ticks. All state is kept in a fixed array, so nothing is allocated.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "debounce.h"
+
+#include <stddef.h>
+
+static Debouncer inputs[DEBOUNCE_MAX_INPUTS];
+static int inputCount = 0;
+
+// ########################################################################################
+// Adds an input. Returns its id, or DEBOUNCE_INVALID if the table is full.
+// ########################################################################################
+static int addInput(uint8_t (*read)(), void (*onPress)(), uint16_t threshold) {
+	Debouncer *input;
+	if (inputCount >= DEBOUNCE_MAX_INPUTS)
+		return DEBOUNCE_INVALID;
+
+	input = &inputs[inputCount];
+	input->read = read;
+	input->onPress = onPress;
+	input->threshold = threshold;
+	input->integrator = 0;
+	input->state = 0;
+	return inputCount++;
+}
+
+// ########################################################################################
+// Registers a polled input that has to stay active for threshold ticks
+// ########################################################################################
+int debounce_registerLevel(uint8_t (*read)(), void (*onPress)(), uint16_t threshold) {
+	return addInput(read, onPress, threshold);
+}
+
+// ########################################################################################
+// Registers an input whose events are ignored for holdoff ticks after one is accepted
+// ########################################################################################
+int debounce_registerEvent(uint16_t holdoff) {
+	return addInput(NULL, NULL, holdoff);
+}
+
+// ########################################################################################
+// Changes the threshold or holdoff of an input, in ticks
+// ########################################################################################
+void debounce_setThreshold(int id, uint16_t threshold) {
+	if (id >= 0 && id < inputCount)
+		inputs[id].threshold = threshold;
+}
+
+// ########################################################################################
+// Event input: returns 1 if the event should be handled, 0 if it is a bounce
+// ########################################################################################
+int debounce_accept(int id) {
+	Debouncer *input = &inputs[id];
+	if (input->integrator > 0)
+		return 0;
+	input->integrator = input->threshold;
+	return 1;
+}
+
+// ########################################################################################
+// Event input: ends the holdoff early so that the next event is accepted
+// ########################################################################################
+void debounce_release(int id) {
+	inputs[id].integrator = 0;
+}
+
+// ########################################################################################
+// Updates every input; run once per tick
+// ########################################################################################
+void debounce_service() {
+	int id;
+	Debouncer *input;
+
+	for (id=0;id<inputCount;id++) {
+		input = &inputs[id];
+		if (input->read == NULL) {
+			// Count down holdoff
+			if (input->integrator > 0)
+				input->integrator--;
+		} else if (input->read()) {
+			if (input->integrator < input->threshold) {
+				input->integrator++;
+			} else if (!input->state) {
+				input->state = 1;
+				if (input->onPress != NULL)
+					input->onPress();
+			}
+		} else {
+			if (input->integrator > 0) {
+				input->integrator--;
+			} else {
+				input->state = 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * Debounce header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+#include <stdint.h>
+
+#define DEBOUNCE_MAX_INPUTS 8
+#define DEBOUNCE_INVALID -1
+
+typedef struct Debouncer
+{
+	// Parameter
+	uint8_t (*read)(); // Returns 1 when active; NULL for inputs that report events
+	void (*onPress)(); // Called once the input has settled in the active state
+	uint16_t threshold; // Ticks the input must agree for, or ticks to ignore events for
+
+	// To be initialized
+	uint16_t integrator;
+	uint8_t state;
+} Debouncer;
+
+int debounce_registerLevel(uint8_t (*read)(), void (*onPress)(), uint16_t threshold);
+
+int debounce_registerEvent(uint16_t holdoff);
+
+void debounce_setThreshold(int id, uint16_t threshold);
+
+int debounce_accept(int id);
+
+void debounce_release(int id);
+
+void debounce_service();
+
+#endif /* DEBOUNCE_H_ */
@@ -0,0 +1,124 @@
+/*****************************************************************************
+ * Fixed point functions
+ *
+ * Everything rounds to nearest, with halves away from zero, so negative
+ * values come out the same as positive ones instead of being pulled down
+ * the way >> and / pull them.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "fixed.h"
+
+// ########################################################################################
+// Rounds a 64 bit Q16.16 intermediate to a whole number
+// ########################################################################################
+static int64_t roundShift(int64_t value, int shift) {
+	int64_t half;
+
+	if (shift <= 0)
+		return value; // Nothing to round
+	half = (int64_t)1 << (shift-1);
+	return (value >= 0) ? (value+half) >> shift : -((-value+half) >> shift);
+}
+
+// ########################################################################################
+// Returns num/den rounded to the nearest whole number
+// ########################################################################################
+int32_t fixed_divRound(int32_t num, int32_t den) {
+	if (den < 0) {
+		num = -num;
+		den = -den;
+	}
+	return (num >= 0) ? (num + den/2)/den : -((-num + den/2)/den);
+}
+
+// ########################################################################################
+// Returns num/den as Q16.16
+// ########################################################################################
+q16_t fixed_fromRatio(int32_t num, int32_t den) {
+	int64_t scaled = (int64_t)num * Q16_ONE;
+	if (den < 0) {
+		scaled = -scaled;
+		den = -den;
+	}
+	return (scaled >= 0) ? (scaled + den/2)/den : -((-scaled + den/2)/den);
+}
+
+// ########################################################################################
+// Returns a Q16.16 number rounded to the nearest whole number
+// ########################################################################################
+int32_t fixed_toInt(q16_t value) {
+	return roundShift(value, Q16_SHIFT);
+}
+
+// ########################################################################################
+// Returns a*b
+// ########################################################################################
+q16_t fixed_mul(q16_t a, q16_t b) {
+	return roundShift((int64_t)a * b, Q16_SHIFT);
+}
+
+// ########################################################################################
+// Returns value*gain + offset rounded, for sensor calibration
+// ########################################################################################
+int32_t fixed_scale(int32_t value, q16_t gain, int32_t offset) {
+	return roundShift((int64_t)value * gain, Q16_SHIFT) + offset;
+}
+
+// ########################################################################################
+// Empties a moving average
+// ########################################################################################
+void fixed_emaInit(FixedEma *ema, uint8_t shift) {
+	ema->value = 0;
+	ema->shift = shift;
+	ema->isPrimed = 0;
+}
+
+// ########################################################################################
+// Adds a sample from -32768 to 32767 and returns the new average
+// ########################################################################################
+int32_t fixed_emaUpdate(FixedEma *ema, int32_t sample) {
+	q16_t target = Q16_FROM_INT(sample);
+
+	if (!ema->isPrimed) {
+		ema->value = target;
+		ema->isPrimed = 1;
+	} else {
+		ema->value += roundShift((int64_t)target - ema->value, ema->shift);
+	}
+	return fixed_toInt(ema->value);
+}
+
+// ########################################################################################
+// Returns the average rounded to a whole number
+// ########################################################################################
+int32_t fixed_emaValue(const FixedEma *ema) {
+	return fixed_toInt(ema->value);
+}
+
+// ########################################################################################
+// Returns the median of up to FIXED_MEDIAN_MAX samples (the lower middle one if even),
+// or 0 if there are none
+// ########################################################################################
+int32_t fixed_median(const int32_t *samples, int count) {
+	int32_t sorted[FIXED_MEDIAN_MAX];
+	int32_t sample;
+	int i, j;
+
+	if (count <= 0)
+		return 0;
+	if (count > FIXED_MEDIAN_MAX)
+		count = FIXED_MEDIAN_MAX;
+	// Insertion sort; there are never more than a few
+	for (i=0;i<count;i++) {
+		sample = samples[i];
+		for (j=i;j>0 && sorted[j-1]>sample;j--)
+			sorted[j] = sorted[j-1];
+		sorted[j] = sample;
+	}
+	return sorted[(count-1)/2];
+}
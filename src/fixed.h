@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * Fixed point header file
+ * (Q16.16 numbers, rounded integer division and filters, with no floating point)
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef FIXED_H_
+#define FIXED_H_
+
+#include <stdint.h>
+
+typedef int32_t q16_t; // 16 integer bits, 16 fraction bits
+
+#define Q16_SHIFT 16
+#define Q16_ONE ((q16_t)1 << Q16_SHIFT)
+#define Q16_FROM_INT(n) ((q16_t)(n) * Q16_ONE) // n from -32768 to 32767
+
+#define FIXED_MEDIAN_MAX 9 // Most samples fixed_median takes
+
+// Exponential moving average; each sample moves it 1/2^shift of the way
+typedef struct FixedEma
+{
+	q16_t value;
+	uint8_t shift;
+	uint8_t isPrimed; // 0 until the first sample, which is taken as it is
+} FixedEma;
+
+int32_t fixed_divRound(int32_t num, int32_t den);
+
+q16_t fixed_fromRatio(int32_t num, int32_t den);
+
+int32_t fixed_toInt(q16_t value);
+
+q16_t fixed_mul(q16_t a, q16_t b);
+
+int32_t fixed_scale(int32_t value, q16_t gain, int32_t offset);
+
+void fixed_emaInit(FixedEma *ema, uint8_t shift);
+
+int32_t fixed_emaUpdate(FixedEma *ema, int32_t sample);
+
+int32_t fixed_emaValue(const FixedEma *ema);
+
+int32_t fixed_median(const int32_t *samples, int count);
+
+#endif /* FIXED_H_ */
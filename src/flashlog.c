@@ -0,0 +1,330 @@
+/*****************************************************************************
+ * Flash log functions
+ *
+ * Keeps events and sensor samples in a ring of flash sectors so they survive
+ * resets and can be fetched after the link to home has been down. Records are
+ * 8 bytes and only ever appended. They are collected in a page buffer in RAM
+ * and written a whole 256 byte page at a time from the main loop, with a
+ * second buffer taking records while the first is written. Pages go round the
+ * ring in order, so every page is erased and written equally often.
+ *
+ * Erasing a sector holds off interrupts for about 100 ms (see iap.c), so the
+ * main loop calls flashlog_eraseAhead while it is idle, and the sector after
+ * the write position is erased once the write position is within
+ * ERASE_AHEAD_PAGES of it. That drops the oldest records a little earlier.
+ * The write path never erases: if the next sector has not been erased in
+ * time, such as during a long song, full pages wait in the buffers and
+ * records that do not fit are dropped and counted.
+ *
+ * Every page starts with a header holding its page number. Record index n is
+ * slot n%31 of page n/31, so a record is found without searching: the page
+ * sits a known distance behind the write position.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "flashlog.h"
+#include "mem.h"
+#include "iap.h"
+#include <string.h>
+
+#include "LPC17xx.h"
+
+#define SECTOR_COUNT (FLASHLOG_LAST_SECTOR-FLASHLOG_FIRST_SECTOR+1)
+#define PAGES_PER_SECTOR (IAP_SECTOR_SIZE/IAP_PAGE_SIZE)
+#define PAGE_COUNT (SECTOR_COUNT*PAGES_PER_SECTOR)
+#define NO_BUFFER -1
+#define NO_SECTOR -1
+#define ERASE_AHEAD_PAGES 32 // Pages left in a sector when the next one may be erased
+
+// Page header data, tells log pages apart from anything else left in flash
+#define HEADER_MAGIC0 'L'
+#define HEADER_MAGIC1 'O'
+#define HEADER_MAGIC2 'G'
+
+typedef union LogPage
+{
+	LogRecord records[FLASHLOG_RECORDS_PER_PAGE+1]; // Header first
+	uint32_t words[IAP_PAGE_SIZE/4];
+} LogPage;
+
+static uint32_t (*getTicks)(void);
+static LogPage buffers[2] MEM_AHB_BSS;
+static volatile int fillBuffer = 0; // Buffer records are added to
+static volatile int fillCount = 0; // Records in the fill buffer
+static volatile int pendingBuffer = NO_BUFFER; // Full buffer waiting to be written
+static uint32_t nextPageNumber = 0;
+static int headPage = 0; // Next page in flash to write
+static uint32_t headPageNumber = 0; // Page number that will be written there
+static uint32_t firstPageNumber = 0; // Oldest page still in flash
+static int erasedSector = NO_SECTOR; // Ring sector erased ahead of the write position
+static volatile uint32_t droppedCount = 0;
+static volatile int isWaitingForErase = 0; // Pending buffer waits for flashlog_eraseAhead
+static volatile uint32_t eraseDroppedCount = 0; // Part of droppedCount lost while waiting
+
+// ########################################################################################
+// Returns a page in flash
+// ########################################################################################
+static const LogPage *getFlashPage(int page) {
+	return (const LogPage *)(iap_sectorAddress(FLASHLOG_FIRST_SECTOR)+page*IAP_PAGE_SIZE);
+}
+
+// ########################################################################################
+// Returns 1 if a page in flash holds log records
+// ########################################################################################
+static int isPageUsed(int page) {
+	const LogRecord *header = &getFlashPage(page)->records[0];
+	return header->type == LOG_PAGE_HEADER && header->data[0] == HEADER_MAGIC0
+			&& header->data[1] == HEADER_MAGIC1 && header->data[2] == HEADER_MAGIC2;
+}
+
+// ########################################################################################
+// Starts a new page in a buffer
+// ########################################################################################
+static void startPage(int buffer) {
+	LogRecord *header = &buffers[buffer].records[0];
+
+	memset(&buffers[buffer], LOG_EMPTY, sizeof(LogPage));
+	header->time = nextPageNumber++;
+	header->type = LOG_PAGE_HEADER;
+	header->data[0] = HEADER_MAGIC0;
+	header->data[1] = HEADER_MAGIC1;
+	header->data[2] = HEADER_MAGIC2;
+	fillBuffer = buffer;
+	fillCount = 0;
+}
+
+// ########################################################################################
+// Hands a full fill buffer over to be written if the other one is free. Needs irqs off.
+// ########################################################################################
+static void rotateBuffers() {
+	if (pendingBuffer != NO_BUFFER)
+		return;
+	pendingBuffer = fillBuffer;
+	startPage(fillBuffer ^ 1);
+}
+
+// ########################################################################################
+// Works out the oldest page still in flash from the write position
+// ########################################################################################
+static void updateFirstPage() {
+	uint32_t stored = PAGE_COUNT;
+
+	// Rest of the current sector has been erased
+	if (headPage % PAGES_PER_SECTOR != 0)
+		stored -= PAGES_PER_SECTOR - headPage % PAGES_PER_SECTOR;
+	// So has the sector erased ahead
+	if (erasedSector != NO_SECTOR)
+		stored -= PAGES_PER_SECTOR;
+	firstPageNumber = (headPageNumber > stored) ? headPageNumber-stored : 0;
+}
+
+// ########################################################################################
+// Writes a buffer to the next page of the ring. Returns 0 if that page is in a sector
+// that has not been erased ahead yet.
+// ########################################################################################
+static int writePage(int buffer) {
+	int sector = FLASHLOG_FIRST_SECTOR + headPage/PAGES_PER_SECTOR;
+	uint32_t address = (uint32_t)getFlashPage(headPage);
+
+	if (headPage % PAGES_PER_SECTOR == 0) {
+		if (erasedSector != headPage/PAGES_PER_SECTOR)
+			return 0;
+		erasedSector = NO_SECTOR;
+	}
+	iap_write(sector, address, buffers[buffer].words, IAP_PAGE_SIZE);
+
+	headPage = (headPage+1) % PAGE_COUNT;
+	headPageNumber = buffers[buffer].records[0].time+1;
+	updateFirstPage();
+	return 1;
+}
+
+// ########################################################################################
+// Finds the write position left by the last run
+// ########################################################################################
+void flashlog_init(uint32_t (*getMsTicks)(void)) {
+	int page, newest = -1;
+
+	getTicks = getMsTicks;
+
+	// Write position is the first free page after a used one
+	headPage = 0;
+	headPageNumber = 0;
+	erasedSector = NO_SECTOR; // Not known, so erased again before use
+	for (page=0;page<PAGE_COUNT;page++) {
+		if (!isPageUsed(page))
+			continue;
+		if (newest < 0 || getFlashPage(page)->records[0].time > getFlashPage(newest)->records[0].time)
+			newest = page;
+	}
+	if (newest >= 0) {
+		headPage = (newest+1) % PAGE_COUNT;
+		headPageNumber = getFlashPage(newest)->records[0].time+1;
+	}
+	updateFirstPage();
+
+	nextPageNumber = headPageNumber;
+	pendingBuffer = NO_BUFFER;
+	startPage(0);
+}
+
+// ########################################################################################
+// Adds a record. Safe to call from interrupts; dropped if both buffers are full.
+// ########################################################################################
+void flashlog_append(uint8_t type, uint8_t data0, uint8_t data1, uint8_t data2) {
+	LogRecord *record;
+
+	__disable_irq();
+	if (fillCount == FLASHLOG_RECORDS_PER_PAGE) {
+		rotateBuffers();
+		if (fillCount == FLASHLOG_RECORDS_PER_PAGE) {
+			droppedCount++;
+			if (isWaitingForErase)
+				eraseDroppedCount++;
+			__enable_irq();
+			return;
+		}
+	}
+	record = &buffers[fillBuffer].records[fillCount+1];
+	record->time = getTicks();
+	record->type = type;
+	record->data[0] = data0;
+	record->data[1] = data1;
+	record->data[2] = data2;
+	fillCount++;
+	if (fillCount == FLASHLOG_RECORDS_PER_PAGE)
+		rotateBuffers();
+	__enable_irq();
+}
+
+// ########################################################################################
+// Writes a full buffer to flash unless it waits for an erase; run from the main loop
+// ########################################################################################
+void flashlog_service() {
+	if (pendingBuffer == NO_BUFFER)
+		return;
+
+	isWaitingForErase = !writePage(pendingBuffer);
+	if (isWaitingForErase)
+		return;
+	__disable_irq();
+	pendingBuffer = NO_BUFFER;
+	if (fillCount == FLASHLOG_RECORDS_PER_PAGE)
+		rotateBuffers();
+	__enable_irq();
+}
+
+// ########################################################################################
+// Erases the sector after the write position once it is close; run from the main loop when idle
+// ########################################################################################
+void flashlog_eraseAhead() {
+	int pagesLeft = (PAGES_PER_SECTOR - headPage%PAGES_PER_SECTOR) % PAGES_PER_SECTOR;
+	int ringSector = ((headPage+pagesLeft) / PAGES_PER_SECTOR) % SECTOR_COUNT;
+
+	if (erasedSector != NO_SECTOR || pagesLeft > ERASE_AHEAD_PAGES)
+		return;
+
+	if (iap_erase(FLASHLOG_FIRST_SECTOR+ringSector, FLASHLOG_FIRST_SECTOR+ringSector) != IAP_CMD_SUCCESS)
+		return;
+	erasedSector = ringSector;
+	updateFirstPage();
+}
+
+// ########################################################################################
+// Writes everything logged so far, including a part filled page, unless it waits for an erase
+// ########################################################################################
+void flashlog_flush() {
+	flashlog_service();
+	__disable_irq();
+	if (fillCount > 0)
+		rotateBuffers();
+	__enable_irq();
+	flashlog_service();
+}
+
+// ########################################################################################
+// Erases the whole log and starts again from index 0
+// ########################################################################################
+void flashlog_erase() {
+	int sector;
+
+	// One sector per call, so interrupts are only held off for one erase at a time
+	for (sector=FLASHLOG_FIRST_SECTOR;sector<=FLASHLOG_LAST_SECTOR;sector++)
+		iap_erase(sector, sector);
+
+	__disable_irq();
+	erasedSector = 0;
+	headPage = 0;
+	headPageNumber = 0;
+	firstPageNumber = 0;
+	nextPageNumber = 0;
+	pendingBuffer = NO_BUFFER;
+	droppedCount = 0;
+	isWaitingForErase = 0;
+	eraseDroppedCount = 0;
+	startPage(0);
+	__enable_irq();
+}
+
+// ########################################################################################
+// Returns index of the oldest record that can still be read
+// ########################################################################################
+uint32_t flashlog_getFirstIndex() {
+	return firstPageNumber*FLASHLOG_RECORDS_PER_PAGE;
+}
+
+// ########################################################################################
+// Returns index the next record will get
+// ########################################################################################
+uint32_t flashlog_getNextIndex() {
+	return buffers[fillBuffer].records[0].time*FLASHLOG_RECORDS_PER_PAGE + fillCount;
+}
+
+// ########################################################################################
+// Returns number of records lost because flash writes could not keep up
+// ########################################################################################
+uint32_t flashlog_getDroppedCount() {
+	return droppedCount;
+}
+
+// ########################################################################################
+// Returns how many of the dropped records were lost waiting for a sector to be erased
+// ########################################################################################
+uint32_t flashlog_getEraseDroppedCount() {
+	return eraseDroppedCount;
+}
+
+// ########################################################################################
+// Reads record index from flash or the buffers. Returns 0 if there is no such record.
+// ########################################################################################
+int flashlog_read(uint32_t index, LogRecord *record) {
+	uint32_t pageNumber = index/FLASHLOG_RECORDS_PER_PAGE;
+	int slot = index%FLASHLOG_RECORDS_PER_PAGE + 1;
+	const LogPage *page = NULL;
+	int buffer;
+
+	if (pageNumber < firstPageNumber)
+		return 0;
+
+	__disable_irq();
+	for (buffer=0;buffer<2;buffer++) {
+		if ((buffer == fillBuffer || buffer == pendingBuffer) && buffers[buffer].records[0].time == pageNumber) {
+			*record = buffers[buffer].records[slot];
+			__enable_irq();
+			return record->type != LOG_EMPTY;
+		}
+	}
+	__enable_irq();
+
+	if (pageNumber >= headPageNumber)
+		return 0;
+	page = getFlashPage((headPage + PAGE_COUNT - (headPageNumber-pageNumber)) % PAGE_COUNT);
+	if (page->records[0].time != pageNumber)
+		return 0;
+	*record = page->records[slot];
+	return record->type != LOG_EMPTY;
+}
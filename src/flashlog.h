@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Flash log header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef FLASHLOG_H_
+#define FLASHLOG_H_
+
+#include <stdint.h>
+
+#define FLASHLOG_FIRST_SECTOR 26 // 0x60000, kept out of the program by the linker script
+#define FLASHLOG_LAST_SECTOR 28
+#define FLASHLOG_RECORDS_PER_PAGE 31 // Plus one page header
+
+// Record types
+#define LOG_EMPTY 0xFF // Erased flash
+#define LOG_PAGE_HEADER 0x00
+#define LOG_BOOT 0x01 // data[0] is the mode at start up
+#define LOG_MODE 0x02 // data[0] is the new mode
+#define LOG_LIGHTNING 0x03 // data[0] is the lightning count
+#define LOG_LIGHT 0x04 // data[0..1] is lux, little endian
+#define LOG_TEMP 0x05 // data[0..1] is tenths of a degree C, little endian
+#define LOG_ACC 0x06 // data[0..2] are x, y and z
+#define LOG_CRASH 0x07 // data[0] is the crash type, data[1] the late watchdog task or 0xFF
+
+typedef struct LogRecord
+{
+	uint32_t time; // ms since start up; page number in a page header
+	uint8_t type;
+	uint8_t data[3];
+} LogRecord;
+
+void flashlog_init(uint32_t (*getMsTicks)(void));
+
+void flashlog_append(uint8_t type, uint8_t data0, uint8_t data1, uint8_t data2);
+
+void flashlog_service();
+
+void flashlog_eraseAhead();
+
+void flashlog_flush();
+
+void flashlog_erase();
+
+uint32_t flashlog_getFirstIndex();
+
+uint32_t flashlog_getNextIndex();
+
+uint32_t flashlog_getDroppedCount();
+
+uint32_t flashlog_getEraseDroppedCount();
+
+int flashlog_read(uint32_t index, LogRecord *record);
+
+#endif /* FLASHLOG_H_ */
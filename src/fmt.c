@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * Formatting functions
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "fmt.h"
+
+#define MAX_DECIMAL_DIGITS 10 // 4294967295
+#define MAX_DECIMALS 9 // 10^9 is the largest power of ten in a uint32_t
+#define MAX_HEX_DIGITS 8
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// ########################################################################################
+// Copies a string
+// ########################################################################################
+char *fmt_str(char *out, const char *str) {
+	while (*str != '\0')
+		*out++ = *str++;
+	*out = '\0';
+	return out;
+}
+
+// ########################################################################################
+// Adds one character
+// ########################################################################################
+char *fmt_char(char *out, char ch) {
+	*out++ = ch;
+	*out = '\0';
+	return out;
+}
+
+// ########################################################################################
+// Writes an unsigned number in decimal, with at least minDigits digits, up to 10
+// ########################################################################################
+static char *writeDecimal(char *out, uint32_t value, int minDigits) {
+	char digits[MAX_DECIMAL_DIGITS];
+	int count = 0;
+
+	if (minDigits > MAX_DECIMAL_DIGITS)
+		minDigits = MAX_DECIMAL_DIGITS;
+
+	// Digits come out backwards, so collect them first
+	do {
+		digits[count++] = '0' + value%10;
+		value /= 10;
+	} while (value != 0 || count < minDigits);
+	while (count > 0)
+		*out++ = digits[--count];
+	*out = '\0';
+	return out;
+}
+
+// ########################################################################################
+// Writes an unsigned number in decimal
+// ########################################################################################
+char *fmt_uint(char *out, uint32_t value) {
+	return writeDecimal(out, value, 1);
+}
+
+// ########################################################################################
+// Writes a signed number in decimal
+// ########################################################################################
+char *fmt_int(char *out, int32_t value) {
+	if (value < 0) {
+		*out++ = '-';
+		// Negate as unsigned so INT32_MIN works too
+		return writeDecimal(out, 0u-(uint32_t)value, 1);
+	}
+	return writeDecimal(out, value, 1);
+}
+
+// ########################################################################################
+// Writes value/10^decimals with that many decimal places, e.g. -5 with 1 is "-0.5".
+// Decimals past 9 are taken as 9.
+// ########################################################################################
+char *fmt_fixed(char *out, int32_t value, int decimals) {
+	uint32_t magnitude, scale = 1;
+	int count;
+
+	if (decimals <= 0)
+		return fmt_int(out, value);
+	if (decimals > MAX_DECIMALS)
+		decimals = MAX_DECIMALS;
+	for (count=0;count<decimals;count++)
+		scale *= 10;
+	if (value < 0) {
+		*out++ = '-';
+		magnitude = 0u-(uint32_t)value;
+	} else {
+		magnitude = value;
+	}
+	out = writeDecimal(out, magnitude/scale, 1);
+	*out++ = '.';
+	return writeDecimal(out, magnitude%scale, decimals);
+}
+
+// ########################################################################################
+// Writes the low digits hex digits of value, upper case with leading zeros, up to 8
+// ########################################################################################
+char *fmt_hex(char *out, uint32_t value, int digits) {
+	int digit;
+
+	// Shifting a uint32_t by 32 or more is undefined
+	if (digits > MAX_HEX_DIGITS)
+		digits = MAX_HEX_DIGITS;
+	for (digit=digits-1;digit>=0;digit--)
+		*out++ = hexDigits[(value >> (digit*4)) & 0xF];
+	*out = '\0';
+	return out;
+}
+
+// ########################################################################################
+// Adds spaces after what was written since start until it is width long
+// ########################################################################################
+char *fmt_pad(char *out, const char *start, int width) {
+	while (out-start < width)
+		*out++ = ' ';
+	*out = '\0';
+	return out;
+}
@@ -0,0 +1,37 @@
+/*****************************************************************************
+ * Formatting header file
+ * (integers, fixed point and hex into a caller's buffer, without printf or the heap)
+ *
+ * Every function writes at out, adds a '\0' and returns a pointer to it, so
+ * calls chain: p = fmt_str(p, "L"); p = fmt_int(p, lux);
+ * The caller makes sure the buffer is big enough; FMT_INT_SIZE covers any
+ * one number.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdint.h>
+
+#define FMT_INT_SIZE 13 // "-2147483648" or "-214748364.8", plus '\0'
+
+char *fmt_str(char *out, const char *str);
+
+char *fmt_char(char *out, char ch);
+
+char *fmt_uint(char *out, uint32_t value);
+
+char *fmt_int(char *out, int32_t value);
+
+char *fmt_fixed(char *out, int32_t value, int decimals);
+
+char *fmt_hex(char *out, uint32_t value, int digits);
+
+char *fmt_pad(char *out, const char *start, int width);
+
+#endif /* FMT_H_ */
@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * In-application flash programming functions
+ *
+ * Thin wrappers around the LPC1768 boot ROM IAP calls. Flash cannot be read
+ * while it is being erased or written, so interrupts are disabled for those
+ * calls; with the vector table in flash an interrupt would otherwise fault.
+ * Preparing sectors does not touch the flash array and runs with interrupts
+ * on. The boot ROM also uses the top 32 bytes of RamLoc32, which the linker
+ * script keeps out of the stack.
+ *
+ * Worst case interrupt latency is one erase call: about 100 ms per 32K
+ * sector, against about 1 ms for a page write. In that time SysTick misses
+ * ticks, UART bytes past the 16 byte receive FIFO are dropped and repeated
+ * GPIO edges on a pin merge into one EINT3. The WDT is fed every 50 ms and
+ * runs for a second, so erase one sector per call and only when idle.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "iap.h"
+
+#include "LPC17xx.h"
+
+#define IAP_LOCATION 0x1FFF1FF1
+#define IAP_PREPARE 50
+#define IAP_COPY_RAM_TO_FLASH 51
+#define IAP_ERASE 52
+#define IAP_ERROR 0xFF // Arguments rejected before calling the boot ROM
+
+typedef void (*IAP)(uint32_t command[], uint32_t result[]);
+
+static const IAP iapEntry = (IAP)IAP_LOCATION;
+
+// ########################################################################################
+// Calls the boot ROM with interrupts disabled, for erases and writes. Returns the IAP status code.
+// ########################################################################################
+static int call(uint32_t command[]) {
+	uint32_t result[5];
+
+	__disable_irq();
+	iapEntry(command, result);
+	__enable_irq();
+	return result[0];
+}
+
+// ########################################################################################
+// Unlocks sectors for the next erase or write. Flash stays readable, so irqs stay on.
+// ########################################################################################
+static int prepare(int startSector, int endSector) {
+	uint32_t command[5];
+	uint32_t result[5];
+
+	command[0] = IAP_PREPARE;
+	command[1] = startSector;
+	command[2] = endSector;
+	iapEntry(command, result);
+	return result[0];
+}
+
+// ########################################################################################
+// Returns the address of the start of a sector
+// ########################################################################################
+uint32_t iap_sectorAddress(int sector) {
+	if (sector < 16)
+		return sector*0x1000;
+	return 0x10000+(sector-16)*IAP_SECTOR_SIZE;
+}
+
+// ########################################################################################
+// Erases a range of sectors. Returns IAP_CMD_SUCCESS or an IAP status code.
+// ########################################################################################
+int iap_erase(int startSector, int endSector) {
+	uint32_t command[5];
+	int status;
+
+	if ((status = prepare(startSector, endSector)) != IAP_CMD_SUCCESS)
+		return status;
+
+	command[0] = IAP_ERASE;
+	command[1] = startSector;
+	command[2] = endSector;
+	command[3] = SystemCoreClock/1000;
+	return call(command);
+}
+
+// ########################################################################################
+// Writes whole pages from word aligned RAM to an erased address in sector
+// ########################################################################################
+int iap_write(int sector, uint32_t address, const void *data, uint32_t length) {
+	uint32_t command[5];
+	int status;
+
+	if ((address % IAP_PAGE_SIZE) != 0 || ((uint32_t)data & 3) != 0)
+		return IAP_ERROR;
+	// Boot ROM only accepts 256, 512, 1024 or 4096 bytes
+	if (length != 256 && length != 512 && length != 1024 && length != 4096)
+		return IAP_ERROR;
+	if ((status = prepare(sector, sector)) != IAP_CMD_SUCCESS)
+		return status;
+
+	command[0] = IAP_COPY_RAM_TO_FLASH;
+	command[1] = address;
+	command[2] = (uint32_t)data;
+	command[3] = length;
+	command[4] = SystemCoreClock/1000;
+	return call(command);
+}
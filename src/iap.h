@@ -0,0 +1,27 @@
+/*****************************************************************************
+ * In-application flash programming header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef IAP_H_
+#define IAP_H_
+
+#include <stdint.h>
+
+#define IAP_PAGE_SIZE 256 // Smallest block that can be written
+#define IAP_SECTOR_SIZE 0x8000 // Sectors 16 to 29 are 32K
+
+// Status codes returned by the boot ROM
+#define IAP_CMD_SUCCESS 0
+
+uint32_t iap_sectorAddress(int sector);
+
+int iap_erase(int startSector, int endSector);
+
+int iap_write(int sector, uint32_t address, const void *data, uint32_t length);
+
+#endif /* IAP_H_ */
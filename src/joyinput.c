@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * Joystick input functions
+ *
+ * The joystick is sampled at a fixed rate. All five switches are debounced
+ * together as a bitmask: a bit only changes once two samples in a row agree.
+ * Held directions are turned into steps that speed up the longer they are
+ * held, and are added up until the consumer collects them as one event.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "joyinput.h"
+
+#include "LPC17xx.h"
+#include "joystick.h"
+
+#define MAX_BATCH_STEPS 100
+
+// Steps per sample after a direction has been held for holdSamples[i] samples
+static const uint8_t holdSamples[] = {0, 10, 25};
+static const uint8_t holdSteps[] = {1, 2, 3};
+
+static uint8_t lastRaw = 0;
+static uint8_t stable = 0;
+static uint8_t holdCount = 0;
+static volatile int8_t batchX = 0;
+static volatile int8_t batchY = 0;
+static volatile uint8_t batchPressed = 0;
+
+// ########################################################################################
+// Returns the number of steps to move for how long the direction has been held
+// ########################################################################################
+static int8_t getSteps() {
+	int level = sizeof(holdSamples)/sizeof(holdSamples[0]) - 1;
+	while (holdCount < holdSamples[level])
+		level--;
+	return holdSteps[level];
+}
+
+// ########################################################################################
+// Adds steps to a batch without overflowing it
+// ########################################################################################
+static int8_t addSteps(int8_t batch, int8_t steps) {
+	int sum = batch+steps;
+	if (sum > MAX_BATCH_STEPS)
+		return MAX_BATCH_STEPS;
+	if (sum < -MAX_BATCH_STEPS)
+		return -MAX_BATCH_STEPS;
+	return sum;
+}
+
+// ########################################################################################
+// Forgets held buttons and pending events
+// ########################################################################################
+void joyinput_reset() {
+	lastRaw = 0;
+	stable = 0;
+	holdCount = 0;
+	batchX = 0;
+	batchY = 0;
+	batchPressed = 0;
+}
+
+// ########################################################################################
+// Samples the joystick; run every JOYINPUT_SAMPLE_TIME
+// ########################################################################################
+void joyinput_sample() {
+	uint8_t raw = joystick_read();
+	uint8_t agreed = ~(raw ^ lastRaw); // Bits equal in both samples
+	uint8_t newStable = (stable & ~agreed) | (raw & agreed);
+	uint8_t directions = newStable & (JOYSTICK_UP|JOYSTICK_DOWN|JOYSTICK_LEFT|JOYSTICK_RIGHT);
+	int8_t steps;
+
+	batchPressed |= newStable & ~stable;
+	lastRaw = raw;
+	stable = newStable;
+
+	if (directions == 0) {
+		holdCount = 0;
+		return;
+	}
+
+	steps = getSteps();
+	if (holdCount < 255)
+		holdCount++;
+	if (directions & JOYSTICK_UP)
+		batchY = addSteps(batchY, -steps);
+	if (directions & JOYSTICK_DOWN)
+		batchY = addSteps(batchY, steps);
+	if (directions & JOYSTICK_LEFT)
+		batchX = addSteps(batchX, -steps);
+	if (directions & JOYSTICK_RIGHT)
+		batchX = addSteps(batchX, steps);
+}
+
+// ########################################################################################
+// Collects everything since the last call. Returns 0 if nothing happened.
+// ########################################################################################
+int joyinput_getEvent(JoyEvent *event) {
+	__disable_irq();
+	event->dx = batchX;
+	event->dy = batchY;
+	event->pressed = batchPressed;
+	batchX = 0;
+	batchY = 0;
+	batchPressed = 0;
+	__enable_irq();
+
+	return event->dx != 0 || event->dy != 0 || event->pressed != 0;
+}
@@ -0,0 +1,30 @@
+/*****************************************************************************
+ * Joystick input header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef JOYINPUT_H_
+#define JOYINPUT_H_
+
+#include <stdint.h>
+
+#define JOYINPUT_SAMPLE_TIME 20 // Joystick is sampled every JOYINPUT_SAMPLE_TIME ms
+
+typedef struct JoyEvent
+{
+	int8_t dx; // Steps moved since the last event, accelerated while held
+	int8_t dy;
+	uint8_t pressed; // JOYSTICK_* bits that went down since the last event
+} JoyEvent;
+
+void joyinput_reset();
+
+void joyinput_sample();
+
+int joyinput_getEvent(JoyEvent *event);
+
+#endif /* JOYINPUT_H_ */
@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * LED bar functions
+ *
+ * Holds the wanted state of the 16 PCA9532 LEDs. Callers, including
+ * interrupts, only change the wanted state; ledbar_update writes it to the
+ * PCA9532 from the main loop, and only when it differs from what was last
+ * written. Blinking is done by the PCA9532 itself using BLINK0, so an
+ * animation costs one write to start and one to stop.
+ *
+ * Each update writes all four LED selectors from the wanted state in one
+ * I2C transfer. The pca9532 driver only ever adds LEDs to BLINK0 and takes
+ * them out when they go off, so an LED that stays on would keep blinking.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "ledbar.h"
+
+#include "LPC17xx.h"
+#include "lpc17xx_i2c.h"
+#include "pca9532.h"
+
+#define PCA9532_I2C_ADDR 0x60
+#define PCA9532_REG_LS0 0x06 // LS1 to LS3 follow
+#define PCA9532_AUTO_INCREMENT 0x10
+#define LS_MODE_OFF 0
+#define LS_MODE_ON 1
+#define LS_MODE_BLINK0 2
+
+static volatile uint16_t wantedOn = 0;
+static volatile uint16_t wantedBlink = 0;
+static uint16_t writtenOn = 0;
+static uint16_t writtenBlink = 0;
+static int isBlinkConfigured = 0;
+
+// ########################################################################################
+// Writes the mode of every LED, blinking first, then on, else off
+// ########################################################################################
+static void writeSelectors(uint16_t on, uint16_t blink) {
+	I2C_M_SETUP_Type setup;
+	uint8_t data[5] = {PCA9532_REG_LS0 | PCA9532_AUTO_INCREMENT, 0, 0, 0, 0};
+	int led, mode;
+
+	for (led=0;led<16;led++) {
+		if (blink & (1 << led))
+			mode = LS_MODE_BLINK0;
+		else if (on & (1 << led))
+			mode = LS_MODE_ON;
+		else
+			mode = LS_MODE_OFF;
+		data[1+led/4] |= mode << (2*(led%4));
+	}
+
+	setup.sl_addr7bit = PCA9532_I2C_ADDR;
+	setup.tx_data = data;
+	setup.tx_length = sizeof(data);
+	setup.rx_data = 0;
+	setup.rx_length = 0;
+	setup.retransmissions_max = 3;
+
+	I2C_MasterTransferData(LPC_I2C2, &setup, I2C_TRANSFER_POLLING);
+}
+
+// ########################################################################################
+// Sets which LEDs are on
+// ########################################################################################
+void ledbar_set(uint16_t leds) {
+	wantedOn = leds;
+}
+
+// ########################################################################################
+// Sets which LEDs blink; blinking LEDs ignore ledbar_set
+// ########################################################################################
+void ledbar_blink(uint16_t leds) {
+	wantedBlink = leds;
+}
+
+// ########################################################################################
+// Writes LED state to the PCA9532 if it has changed; run from the main loop
+// ########################################################################################
+void ledbar_update() {
+	uint16_t on = wantedOn;
+	uint16_t blink = wantedBlink;
+
+	if (on == writtenOn && blink == writtenBlink)
+		return;
+
+	if (blink != 0 && !isBlinkConfigured) {
+		pca9532_setBlink0Period(LEDBAR_BLINK_PERIOD);
+		pca9532_setBlink0Duty(LEDBAR_BLINK_DUTY);
+		isBlinkConfigured = 1;
+	}
+
+	writeSelectors(on, blink);
+
+	writtenOn = on;
+	writtenBlink = blink;
+}
@@ -0,0 +1,24 @@
+/*****************************************************************************
+ * LED bar header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef LEDBAR_H_
+#define LEDBAR_H_
+
+#include <stdint.h>
+
+#define LEDBAR_BLINK_PERIOD 37 // (37+1)/152 s, about 250 ms
+#define LEDBAR_BLINK_DUTY 128 // 50%
+
+void ledbar_set(uint16_t leds);
+
+void ledbar_blink(uint16_t leds);
+
+void ledbar_update();
+
+#endif /* LEDBAR_H_ */
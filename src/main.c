@@ -9,11 +9,30 @@
  ******************************************************************************/
 // Global includes
 #include <stdio.h>
-#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Class includes
 #include "task.h"
+#include "terminal.h"
+#include "canvas.h"
+#include "joyinput.h"
+#include "debounce.h"
+#include "song.h"
+#include "synth.h"
+#include "ledbar.h"
+#include "seg7.h"
+#include "accel.h"
+#include "tempsense.h"
+#include "sensors.h"
+#include "command.h"
+#include "params.h"
+#include "flashlog.h"
+#include "mem.h"
+#include "boot.h"
+#include "crash.h"
+#include "watchdog.h"
+#include "fmt.h"
 
 // CMSIS headers required for setting up SysTick Timer
 #include "LPC17xx.h"
@@ -28,40 +47,59 @@
 
 #include "joystick.h"
 #include "pca9532.h"
-#include "acc.h"
 #include "oled.h"
 #include "rgbfixed.h"
 #include "led7seg.h"
-#include "temp.h"
 #include "light.h"
 
 //-----------------------------------------------------------------------------------------
 // Constants
 //-----------------------------------------------------------------------------------------
-#define SAMPLING_TIME 2000
+#define SAMPLING_TIME 2000 // Defaults of the parameters, which can be changed with SET
+#define REPORT_MAX_AGE 1000 // Oldest sensor values sent in a periodic report
+#define SW3_REPORT_MAX_AGE 250 // Oldest sensor values sent when SW3 is pressed
 #define LIGHTNING_THRESHOLD 3000
 #define LIGHTNING_THRESHOLD_TIME 500
 #define LIGHTNING_TIME_WINDOW 3000
 #define LIGHT_MONITORING 3000
 #define TIME_UNIT 250
-#define TICK_MILLIS 5 // sysTick ticks every TICK_MILLIS; controls how reactive you want the system to be
+#define STARTING_SEQ_TIME 1000 // Each character of the starting sequence
+#define STARTING_ANI_TIME 50 // Each frame of the starting animation
+#define STARTING_ANI_CHAR 7 // Animation starts with the 'A' of the starting sequence
+#define TICK_MILLIS TASK_TICK_MILLIS // sysTick ticks every TICK_MILLIS; controls how reactive you want the system to be
 #define RANGE_K2 3892
 #define NUM_OF_LED 16
 #define NUM_OF_STRIPES 100
 #define DEBOUNCE_TIME 500
+#define TEMP_OFFSET 0 // Added to the temperature sensor, tenths of a degree C
+#define SW3_DEBOUNCE_TIME 20
+#define CANVAS_FRAME_TIME 40
 #define MAX_SONG_LENGTH 256
-#define NOTE_PIN_HIGH() GPIO_SetValue(0, 1<<26);
-#define NOTE_PIN_LOW()  GPIO_ClearValue(0, 1<<26);
+#define RGB_BLINK_PERIOD 2000
+#define MAX_LOG_DUMP 4096 // Records sent by one LOG DUMP
+#define SENSORS_WATCH_DEADLINE 3000 // Longest a watched task may go without running
+#define ACCEL_WATCH_DEADLINE 500
+#define TEMP_WATCH_DEADLINE 2000
+#define MAIN_LOOP_WATCH_DEADLINE 2000 // scroll7SegTask is always on the slow list
+#define TELEMETRY_SIZE 48 // Longest line from formatTelemetry, with room to spare
+#define OLED_FIELD_WIDTH 5 // Characters in each OLED sensor value
+//#define BENCHMARK // Adds BENCH, which links snprintf back in to time it against fmt
+#define BENCH_LINES 100 // Telemetry lines formatted each way by BENCH FMT
+#define BENCH_TICKS 100 // Scheduler ticks timed each way by BENCH TASKS
+#define BENCH_TASK_INTERVAL 60000 // Long enough that no task comes due during BENCH TASKS
+#define LOG_DUMP_GRACE 100 // Extra watchdog time per LOG DUMP line, which blocks the main loop
+#define CANVAS_GRACE 100 // Extra watchdog time per row or stroke of a canvas redraw or export
+#define KEY_QUEUE_LENGTH 16 // Keystrokes waiting for the main loop, a power of 2
 
 //-----------------------------------------------------------------------------------------
 // Function definitions
 //-----------------------------------------------------------------------------------------
 void UART3ReceiveInterruptHandler();
-static void drawOled(uint8_t joyState);
-void sendControlSeq(uint8_t* seq);
+static void drawOled(JoyEvent *event);
 void stopCanvas();
 void stopMusic();
-void sw3Interrupt();
+void sw3Pressed();
+void resetLEDSeq();
 static void lightningInterruptHandler();
 
 //-----------------------------------------------------------------------------------------
@@ -76,31 +114,75 @@ int curMode = STARTER; // Default mode - STARTER
 int prevMode = -1;
 volatile int hasModeChanged = 1;
 
+//-----------------------------------------------------------------------------------------
+// Devices, brought up when a mode first needs them and otherwise one per main loop pass
+//-----------------------------------------------------------------------------------------
+#define DEVICE_OLED 0x01
+#define DEVICE_SENSORS 0x02
+#define DEVICE_JOYSTICK 0x04
+#define DEVICE_SPEAKER 0x08
+#define DEVICE_ALL 0x0F
+const uint8_t modeDevices[] = {
+		DEVICE_OLED,                   // STARTER
+		DEVICE_OLED | DEVICE_SENSORS,  // EXPLORER
+		DEVICE_OLED | DEVICE_SENSORS,  // SURVIVAL
+		DEVICE_OLED | DEVICE_JOYSTICK, // CANVAS
+		DEVICE_OLED | DEVICE_SPEAKER   // MUSIC
+};
+uint8_t readyDevices = 0;
+
 //-----------------------------------------------------------------------------------------
 // Tasks
 //-----------------------------------------------------------------------------------------
-Task *showStartingSeqTask;
-Task *showStartingAniTask;
-Task *blinkRGBTask;
-Task *getSensorValuesTask;
-Task *showLEDSeqTask;
-Task *resetLEDSeqTask;
-Task *UARTDebounceTask;
-Task *readJoystickTask;
-Task *joystickDebounceTask;
-
-Task *slowTaskList[30];
-int slowTaskCount = 0;
-Task *fastTaskList[30];
-int fastTaskCount = 0;
+// X(task, function, interval, repeatCount) for every task that always exists. They are
+// filled in by the compiler, ticks included, so there is nothing to set up at boot.
+// Intervals that are parameters start at their defaults; the sequences are coroutines
+// and are given repeat counts when they are started.
+#define STATIC_TASKS(X) \
+	X(showStartingSeqTask, showStartingSeq, COROUTINE_INTERVAL, 0) \
+	X(showStartingAniTask, showStartingAni, COROUTINE_INTERVAL, 0) \
+	X(getSensorValuesTask, getSensorValues, SAMPLING_TIME, -1) \
+	X(showLEDSeqTask, showLEDSeq, COROUTINE_INTERVAL, 0) \
+	X(sampleJoystickTask, joyinput_sample, JOYINPUT_SAMPLE_TIME, -1) \
+	X(readJoystickTask, readJoystick, CANVAS_FRAME_TIME, -1) \
+	X(playSongTask, tickSong, TICK_MILLIS, -1) \
+	X(measureTempTask, tempsense_start, TEMPSENSE_INTERVAL, -1) \
+	X(sampleSensorsTask, sensors_sample, SENSORS_SAMPLE_TIME, -1) \
+	X(sampleAccTask, accel_sample, ACCEL_SAMPLE_TIME, -1) \
+	X(scroll7SegTask, seg7_scroll, SEG7_SCROLL_TIME, -1)
+
+#define TASK_PROTOTYPE(task, function, interval, repeatCount) void function();
+#define TASK_ID(task, function, interval, repeatCount) task##Id,
+#define TASK_ENTRY(task, function, interval, repeatCount) TASK_INIT(&function, interval, repeatCount),
+#define TASK_POINTER(task, function, interval, repeatCount) Task *const task = &staticTasks[task##Id];
+
+STATIC_TASKS(TASK_PROTOTYPE)
+enum { STATIC_TASKS(TASK_ID) STATIC_TASK_COUNT };
+static Task staticTasks[STATIC_TASK_COUNT] = { STATIC_TASKS(TASK_ENTRY) };
+STATIC_TASKS(TASK_POINTER)
+
+TaskList slowTaskList; // Run from the main loop
+TaskList fastTaskList; // Run from the TIMER0 interrupt
 
 //-----------------------------------------------------------------------------------------
 // Common variables
 //-----------------------------------------------------------------------------------------
 int isBlinking = 0;
-int isRGBLEDOn = 0;
 int isOLEDOn = 0;
-int isUARTDebounced = 0;
+int UARTDebounceId;
+int sw3DebounceId;
+volatile int isSensorReportRequested = 0;
+uint8_t keyQueue[KEY_QUEUE_LENGTH]; // Menu keystrokes from the UART interrupt
+volatile uint8_t keyHead = 0; // Next keystroke to write
+volatile uint8_t keyTail = 0; // Next keystroke to read
+int samplingTime = SAMPLING_TIME;
+int lightningThreshold = LIGHTNING_THRESHOLD;
+int lightningThresholdTime = LIGHTNING_THRESHOLD_TIME;
+int lightningTimeWindow = LIGHTNING_TIME_WINDOW;
+uint16_t timeUnit = TIME_UNIT;
+uint8_t tickMillis = TICK_MILLIS;
+uint16_t debounceTime = DEBOUNCE_TIME;
+int32_t tempOffset = TEMP_OFFSET;
 volatile uint32_t msTicks = 0; // counter for 1ms SysTicks
 int curTicks = 0;
 int lightningCount = 0;
@@ -112,7 +194,8 @@ uint8_t curRGBLEDColor = RGB_BLUE;
 uint8_t startingSeq[13] = {'0', '1', '2', '3', '4', '5', '6', 'A', 'B', 'C', 'D', 'E', 'F'};
 int seqLength = sizeof(startingSeq)/sizeof(uint8_t);
 int curSeqIndex = 0;
-int curAniIndex = 0;
+Coroutine startingSeqCo;
+Coroutine startingAniCo;
 int stripesX[NUM_OF_STRIPES];
 int stripesY[NUM_OF_STRIPES];
 uint8_t nameSeq[13] = {'H', 'O', 'P', 'E', ' ', 'b', 'y', ' ', 'C', 'M', '&', 'T', 'C'};
@@ -120,13 +203,13 @@ uint8_t nameSeq[13] = {'H', 'O', 'P', 'E', ' ', 'b', 'y', ' ', 'C', 'M', '&', 'T
 //-----------------------------------------------------------------------------------------
 // EXPLORER mode variables
 //-----------------------------------------------------------------------------------------
-int8_t zInitial; // Initial value of z
 
 //-----------------------------------------------------------------------------------------
 // SURVIVAL mode variables
 //-----------------------------------------------------------------------------------------
 uint16_t ledOn = 0xffff;
-int curLEDPos = 16;
+Coroutine ledSeqCo;
+volatile int isLEDSeqHeld = 0; // Countdown stays full while lightning is seen
 
 //-----------------------------------------------------------------------------------------
 // CANVAS & MUSIC variables
@@ -144,44 +227,26 @@ char *menu[] = {
 		"Collaborative canvas\n\r"
 		"Use WASD to draw on the screen.\n\r"
 		"Use IJKL to move your cursor.\n\r"
+		"Press R to redraw, X to export, C to clear.\n\r"
 		"Press Q to quit.\n\r"
 		"\n\r",
 
 		"Music\n\r"
 		"Enter a sequence of notes to play.\n\r"
 		"Example: C2.C2,D4,C4,F4,E8\n\r"
+		"Start with * to loop, @150 sets tempo to 150%, ! stops.\n\r"
 		"Press Q to quit.\n\r"
 		"\n\r"
 		};
 int curMenuPos = 0;
-uint8_t up[4] = "[1A";
-uint8_t down[4] = "[1B";
-uint8_t left[4] = "[1D";
-uint8_t right[4] = "[1C";
-uint8_t clear[4] = "[2J";
-uint8_t home[7] = "[H";
-uint8_t center[8] = "[32;48H";
-int isJoystickDebounced = 0;
-static uint8_t currX = 48;
-static uint8_t currY = 32;
-static uint8_t lastX = 0;
-static uint8_t lastY = 0;
-static uint32_t notes[] = {
-        2272, // A - 440 Hz
-        2024, // B - 494 Hz
-        3816, // C - 262 Hz
-        3401, // D - 294 Hz
-        3030, // E - 330 Hz
-        2865, // F - 349 Hz
-        2551, // G - 392 Hz
-        1136, // a - 880 Hz
-        1012, // b - 988 Hz
-        1912, // c - 523 Hz
-        1703, // d - 587 Hz
-        1517, // e - 659 Hz
-        1432, // f - 698 Hz
-        1275, // g - 784 Hz
-};
+uint8_t songLine[MAX_SONG_LENGTH] MEM_AHB_BSS;
+int songLineLength = 0;
+
+//-----------------------------------------------------------------------------------------
+// Command protocol variables
+//-----------------------------------------------------------------------------------------
+const char *modeNames[] = {"STARTER", "EXPLORER", "SURVIVAL", "CANVAS", "MUSIC"};
+const char *faultNames[] = {"NONE", "HARD", "MEM", "BUS", "USAGE", "WATCHDOG"};
 
 // ########################################################################################
 // Initialize SSP
@@ -316,7 +381,6 @@ void initSpeaker() {
     GPIO_SetDir(0, 1<<27, 1);
     GPIO_SetDir(0, 1<<28, 1);
     GPIO_SetDir(2, 1<<13, 1);
-    GPIO_SetDir(0, 1<<26, 1);
 
     GPIO_ClearValue(0, 1<<27); //LM4811-clk
     GPIO_ClearValue(0, 1<<28); //LM4811-up/dn
@@ -333,8 +397,6 @@ void initGPIOInterrupt(void)
 
 	// Light sensor Enable GPIO Interrupt P2.5
 	LPC_GPIOINT->IO2IntEnF |= 1<<5;
-    // SW3 - Enable GPIO Interrupt P2.10
-    LPC_GPIOINT->IO2IntEnF |= 1<<10;
     // Enable EINT3 interrupt
     NVIC_EnableIRQ(EINT3_IRQn);
     // Set priority of interrupt
@@ -373,7 +435,7 @@ void initTimerInterrupt() {
 	//do no thing for external output
 	TIM_MatchConfigStruct.ExtMatchOutputType =TIM_EXTMATCH_NOTHING;
 	// Set Match value, count value is ms (timer * 1000uS =timer mS )
-	TIM_MatchConfigStruct.MatchValue = TICK_MILLIS;
+	TIM_MatchConfigStruct.MatchValue = tickMillis;
 
 	// Timer 0 - Set configuration for Tim_config and Tim_MatchcConfig
 	TIM_Init(LPC_TIM0, TIM_TIMER_MODE, &TIM_ConfigStruct);
@@ -392,7 +454,7 @@ void initTimerInterrupt() {
 // Common: Blank 7Seg
 // ########################################################################################
 void blank7Seg() {
-	led7seg_setChar(0xFF, TRUE);
+	seg7_blank();
 }
 
 // ########################################################################################
@@ -411,81 +473,71 @@ void blankRGBLED() {
 }
 
 // ########################################################################################
-// Common: Send control seq to position cursor
+// Common: Read SW3 for debouncing, returns 1 when pressed
 // ########################################################################################
-void sendControlSeq(uint8_t* seq) {
-	uint8_t data = 27;
-	UART_Send(LPC_UART3, &data, 1, BLOCKING);
-	UART_Send(LPC_UART3, (uint8_t *)seq , strlen(seq), BLOCKING);
+uint8_t readSW3() {
+	return !((GPIO_ReadValue(2) >> 10) & 0x1);
 }
 
 // ########################################################################################
-// Common: Debounce callback for UART
+// STARTER: Show sequence, one character every STARTING_SEQ_TIME, then go to EXPLORER
 // ########################################################################################
-void UARTDebounceTimeout() {
-	isUARTDebounced = 0;
+void showStartingSeq() {
+	COROUTINE_BEGIN(&startingSeqCo);
+	for (curSeqIndex=0;curSeqIndex<seqLength;curSeqIndex++) {
+		seg7_showChar(startingSeq[curSeqIndex]);
+		COROUTINE_AWAIT_MS(&startingSeqCo, STARTING_SEQ_TIME);
+	}
+	blank7Seg();
+	prevMode = curMode;
+	curMode = EXPLORER;
+	hasModeChanged = 1;
+	COROUTINE_END(&startingSeqCo, showStartingSeqTask);
 }
 
 // ########################################################################################
-// STARTER: Show sequence
-// ########################################################################################
-void showStartingSeq() {
-	  if (curSeqIndex < seqLength) {
-		  led7seg_setChar(startingSeq[curSeqIndex], FALSE);
-		  curSeqIndex++;
-	  }
-	  else {
-		  blank7Seg();
-		  prevMode = curMode;
-		  curMode = EXPLORER;
-		  hasModeChanged = 1;
-	  }
-	  if (curSeqIndex==8) {
-			// Add starting animation task
-			curAniIndex = 0;
-			showStartingAniTask->repeatCount = 120;
-			showStartingAniTask->runCount = 0;
-			addTask(fastTaskList, &fastTaskCount, showStartingAniTask);
-	  }
-}
-
-// ########################################################################################
-// STARTER: Show animation
+// STARTER: Show animation, starting when the sequence gets to STARTING_ANI_CHAR
 // ########################################################################################
 void showStartingAni() {
-	if (curAniIndex < 64) {
-		int count;
+	static int frame; // Static, as locals do not last over an await
+	int count;
+
+	COROUTINE_BEGIN(&startingAniCo);
+	COROUTINE_AWAIT_UNTIL(&startingAniCo, curSeqIndex >= STARTING_ANI_CHAR);
+	// Stripes fall while a line rises
+	for (frame=0;frame<64;frame++) {
 		for (count = 0; count < NUM_OF_STRIPES; count++) {
-			oled_putPixel(stripesX[count], (stripesY[count]+curAniIndex)%(63-curAniIndex), OLED_COLOR_WHITE);
-			oled_putPixel(stripesX[count], (stripesY[count]+curAniIndex-5)%(63-curAniIndex), OLED_COLOR_BLACK);
+			oled_putPixel(stripesX[count], (stripesY[count]+frame)%(63-frame), OLED_COLOR_WHITE);
+			oled_putPixel(stripesX[count], (stripesY[count]+frame-5)%(63-frame), OLED_COLOR_BLACK);
 		}
-		oled_line(0, 63-curAniIndex, 96, 63-curAniIndex, OLED_COLOR_WHITE);
-	} else  if (curAniIndex < 77){
-		oled_putChar(8+(curAniIndex-64)*6, 15, nameSeq[curAniIndex-64], OLED_COLOR_BLACK, OLED_COLOR_WHITE);
-	} else if (curAniIndex == 77) {
-		oled_circle(17, 40, 15, OLED_COLOR_BLACK);
-		oled_putChar(15, 37, 'E', OLED_COLOR_BLACK, OLED_COLOR_WHITE);
-		oled_circle(82, 40, 10, OLED_COLOR_BLACK);
-		oled_putChar(80, 37, 'M', OLED_COLOR_BLACK, OLED_COLOR_WHITE);
-	} else if (curAniIndex < 119 && curAniIndex%3!=0){
-		oled_putPixel(curAniIndex-46, 40, OLED_COLOR_BLACK);
+		oled_line(0, 63-frame, 96, 63-frame, OLED_COLOR_WHITE);
+		COROUTINE_AWAIT_MS(&startingAniCo, STARTING_ANI_TIME);
 	}
-	curAniIndex++;
-
+	// Name, a character at a time
+	for (frame=0;frame<sizeof(nameSeq);frame++) {
+		oled_putChar(8+frame*6, 15, nameSeq[frame], OLED_COLOR_BLACK, OLED_COLOR_WHITE);
+		COROUTINE_AWAIT_MS(&startingAniCo, STARTING_ANI_TIME);
+	}
+	oled_circle(17, 40, 15, OLED_COLOR_BLACK);
+	oled_putChar(15, 37, 'E', OLED_COLOR_BLACK, OLED_COLOR_WHITE);
+	oled_circle(82, 40, 10, OLED_COLOR_BLACK);
+	oled_putChar(80, 37, 'M', OLED_COLOR_BLACK, OLED_COLOR_WHITE);
+	COROUTINE_AWAIT_MS(&startingAniCo, STARTING_ANI_TIME);
+	// Dotted line between the circles
+	for (frame=32;frame<73;frame++) {
+		if (frame%3 != 2)
+			oled_putPixel(frame, 40, OLED_COLOR_BLACK);
+		COROUTINE_AWAIT_MS(&startingAniCo, STARTING_ANI_TIME);
+	}
+	COROUTINE_END(&startingAniCo, showStartingAniTask);
 }
 
 // ########################################################################################
 // EXPLORER & SURVIVAL: Blink indicator
 // ########################################################################################
 void blinkRGBLED() {
-    // Clear RGB LEDs
-    if (isRGBLEDOn) {
-    	rgb_setLeds(RGB_GREEN);
-    	isRGBLEDOn = 0;
-    } else {
-    	rgb_setLeds(RGB_GREEN|curRGBLEDColor);
-    	isRGBLEDOn = 1;
-    }
+	// PWM blinks the LED, no task needed
+	rgb_blink(RGB_GREEN, curRGBLEDColor, RGB_BLINK_PERIOD);
 }
 
 // ########################################################################################
@@ -494,31 +546,71 @@ void blinkRGBLED() {
 void setRGBLEDColor(uint8_t newColor) {
     curRGBLEDColor = newColor;
 	// Update RGB LEDs
-    if (isRGBLEDOn) {
-    	rgb_setLeds(RGB_GREEN|curRGBLEDColor);
+    if (isBlinking) {
+    	blinkRGBLED();
     }
 }
 
 
 // ########################################################################################
-// EXPLORER & SURVIVAL: Read sensor values, display on OLED and send to home
+// EXPLORER & SURVIVAL: Write a temperature in tenths of a degree, or --.- if there is none yet
 // ########################################################################################
-void getSensorValues() {
+static char *formatTemp(char *out, int32_t t) {
+	if (t == TEMPSENSE_INVALID)
+		return fmt_str(out, "--.-");
+	return fmt_fixed(out, t, 1);
+}
+
+// ########################################################################################
+// EXPLORER & SURVIVAL: Build the line sent to home, e.g. L120_T25.5_AX1_AY-2_AZ64
+// ########################################################################################
+static char *formatTelemetry(char *out, int l, int32_t t, int8_t x, int8_t y, int8_t z) {
+	out = fmt_int(fmt_str(out, "L"), l);
+	out = formatTemp(fmt_str(out, "_T"), t);
+	out = fmt_int(fmt_str(out, "_AX"), x);
+	out = fmt_int(fmt_str(out, "_AY"), y);
+	out = fmt_int(fmt_str(out, "_AZ"), z);
+	return fmt_str(out, "\r\n");
+}
+
+// ########################################################################################
+// EXPLORER & SURVIVAL: Pad an OLED value field over the last value and cut it to fit
+// ########################################################################################
+static void fitOledField(char *field, char *end) {
+	fmt_pad(end, field, OLED_FIELD_WIDTH);
+	field[OLED_FIELD_WIDTH] = '\0';
+}
+
+// ########################################################################################
+// EXPLORER & SURVIVAL: Display sensor values no older than maxAge on OLED and send to home
+// ########################################################################################
+void reportSensorValues(uint32_t maxAge) {
+	const SensorSnapshot *snapshot;
 	// Get light sensor value
 	int l;
-	l = light_read();
-	// Get temperature
+	l = sensors_get(SENSOR_LIGHT, maxAge)->value[0];
+	// Get temperature, which may not have been measured yet
 	int32_t t;
-	t = temp_read();
-	// Get accelerometer readings
+	snapshot = sensors_get(SENSOR_TEMP, maxAge);
+	t = snapshot->isValid ? snapshot->value[0] : TEMPSENSE_INVALID;
+	// Get accelerometer readings averaged over the snapshot
 	int8_t x,y,z;
-    acc_read(&x, &y, &z);
-    z = z-zInitial;
+	snapshot = sensors_get(SENSOR_ACC, maxAge);
+	x = snapshot->value[0];
+	y = snapshot->value[1];
+	z = snapshot->value[2];
+
+	// Keep a copy in flash in case home is not listening
+	flashlog_append(LOG_LIGHT, l & 0xFF, (l >> 8) & 0xFF, 0);
+	if (t != TEMPSENSE_INVALID)
+		flashlog_append(LOG_TEMP, t & 0xFF, (t >> 8) & 0xFF, 0);
+	flashlog_append(LOG_ACC, x, y, z);
 
     // Send string to home
-    char homeString[38];
-    snprintf(homeString, sizeof(homeString), "L%d_T%d.%d_AX%d_AY%d_AZ%d\r\n", l, t/10, t%10, x, y, z);
+    char homeString[TELEMETRY_SIZE];
+    formatTelemetry(homeString, l, t, x, y, z);
 	UART_Send(LPC_UART3, (uint8_t *)homeString , strlen(homeString), BLOCKING);
+	boot_checkpoint(BOOT_TELEMETRY);
 
 	if (!isOLEDOn) {
 		char lum[5] = "Lum:", temp[6] = "Temp:", xAxis[8] = "X-axis:", yAxis[8] = "Y-axis:", zAxis[8] = "Z-axis:";
@@ -540,13 +632,13 @@ void getSensorValues() {
     }
 
 	// Print values
-	char lumC[6], tempC[6], xAxisC[6], yAxisC[6], zAxisC[6];
-	//Convert to char
-	snprintf(lumC, sizeof lumC, "%d     ", l);
-	snprintf(tempC, sizeof lumC, "%d.%d     ", t/10, t%10);
-	snprintf(xAxisC, sizeof lumC, "%d     ", x);
-	snprintf(yAxisC, sizeof lumC, "%d     ", y);
-	snprintf(zAxisC, sizeof lumC, "%d     ", z);
+	char lumC[FMT_INT_SIZE], tempC[FMT_INT_SIZE], xAxisC[FMT_INT_SIZE], yAxisC[FMT_INT_SIZE], zAxisC[FMT_INT_SIZE];
+	//Convert to char, padded with spaces over the last value and cut to the field
+	fitOledField(lumC, fmt_int(lumC, l));
+	fitOledField(tempC, formatTemp(tempC, t));
+	fitOledField(xAxisC, fmt_int(xAxisC, x));
+	fitOledField(yAxisC, fmt_int(yAxisC, y));
+	fitOledField(zAxisC, fmt_int(zAxisC, z));
 	// Convert to string and print
 	uint8_t *myString = (uint8_t *) lumC;
 	oled_putString(45, 0, myString, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
@@ -560,15 +652,35 @@ void getSensorValues() {
 	oled_putString(45, 40, myString, OLED_COLOR_WHITE, OLED_COLOR_BLACK);
 }
 
+// ########################################################################################
+// EXPLORER: Periodic sensor report
+// ########################################################################################
+void getSensorValues() {
+	reportSensorValues(REPORT_MAX_AGE);
+}
+
+// ########################################################################################
+// EXPLORER & SURVIVAL: Send accelerometer events to home
+// ########################################################################################
+void reportAccEvents() {
+	uint8_t events = accel_getEvents();
+
+	if (events & ACCEL_EVENT_MOTION)
+		term_write("ACC_MOTION\r\n");
+	if (events & ACCEL_EVENT_TAP)
+		term_write("ACC_TAP\r\n");
+	if (events & ACCEL_EVENT_FREEFALL)
+		term_write("ACC_FREEFALL\r\n");
+}
+
 // ########################################################################################
 // EXPLORER & SURVIVAL: Update lightning count
 // ########################################################################################
 void updateLightningCount() {
 	if (lightningCount==0) {
-		led7seg_setChar(0xFF, TRUE);
+		seg7_blank();
 	} else {
-		char count = lightningCount+'0'; // Convert to char
-		led7seg_setChar(count, FALSE);
+		seg7_showNumber(lightningCount);
 	}
 }
 
@@ -585,7 +697,7 @@ void lightningTimeout() {
 // ########################################################################################
 void enableLightningDetector()
 {
-    light_setHiThreshold(LIGHTNING_THRESHOLD);
+    light_setHiThreshold(lightningThreshold);
     light_setLoThreshold(0);
     light_clearIrqStatus();
 }
@@ -600,6 +712,51 @@ void disableLightningDetector()
     light_clearIrqStatus();
 }
 
+// ########################################################################################
+// Common: Bring up the given devices that are not up yet
+// ########################################################################################
+void bringUpDevices(uint8_t devices) {
+	devices &= ~readyDevices;
+	if (devices & DEVICE_OLED) {
+		oled_init();
+	}
+	if (devices & DEVICE_SENSORS) {
+		light_enable();
+		// Set light sensor range
+		light_setRange(LIGHT_RANGE_4000);
+		// Disable lightning detector until a mode needs it
+		disableLightningDetector();
+		tempsense_init();
+		addTask(&slowTaskList, measureTempTask);
+		// Take initial rest position of the accelerometer
+		accel_init();
+	}
+	if (devices & DEVICE_JOYSTICK) {
+		joystick_init();
+	}
+	if (devices & DEVICE_SPEAKER) {
+		// Initialize speaker synth
+		song_init();
+	}
+	readyDevices |= devices;
+	if (readyDevices == DEVICE_ALL) {
+		boot_checkpoint(BOOT_DEVICES);
+	}
+}
+
+// ########################################################################################
+// Common: Bring up one device no mode has needed yet
+// ########################################################################################
+void bringUpNextDevice() {
+	uint8_t device;
+	for (device=DEVICE_OLED;device&DEVICE_ALL;device<<=1) {
+		if (!(readyDevices & device)) {
+			bringUpDevices(device);
+			return;
+		}
+	}
+}
+
 // ########################################################################################
 // SURVIVAL: Show all sensor values as S
 // ########################################################################################
@@ -633,28 +790,32 @@ void blankSensorValues() {
 }
 
 // ########################################################################################
-// SURVIVAL: Show LED sequence and turns off the next LED
+// SURVIVAL: Show LED sequence, turning off an LED every timeUnit, then go to EXPLORER
 // ########################################################################################
 void showLEDSeq() {
-	if (curLEDPos < 0) {
-		prevMode = curMode;
-		curMode = EXPLORER;
-		hasModeChanged = 1;
-	} else {
-		pca9532_setLeds(ledOn, 0xffff);
-		ledOn &= ~(1 << curLEDPos);
-		curLEDPos--;
+	static int ledPos; // Static, as locals do not last over an await
+
+	if (isLEDSeqHeld) {
+		resetLEDSeq();
+		return;
+	}
+	COROUTINE_BEGIN(&ledSeqCo);
+	for (ledPos=NUM_OF_LED;ledPos>=0;ledPos--) {
+		ledbar_set(ledOn);
+		ledOn &= ~(1 << ledPos);
+		COROUTINE_AWAIT_MS(&ledSeqCo, timeUnit);
 	}
-//	printf("LED: %d\n", curLEDPos);
+	prevMode = curMode;
+	curMode = EXPLORER;
+	hasModeChanged = 1;
+	COROUTINE_END(&ledSeqCo, showLEDSeqTask);
 }
 
 // ########################################################################################
 // SURVIVAL: Reset LED sequence
 // ########################################################################################
 void resetLEDSeq() {
-	showLEDSeqTask->runCount = 0;
-	showLEDSeqTask->repeatCount = NUM_OF_LED+2;
-	curLEDPos = 16;
+	COROUTINE_RESTART(&ledSeqCo);
 	ledOn = 0xffff;
 }
 
@@ -662,208 +823,79 @@ void resetLEDSeq() {
 // SURVIVAL: Turn off LED sequence
 // ########################################################################################
 void turnOffLEDSeq() {
-	pca9532_setLeds(0x0000, 0xffff);
+	isLEDSeqHeld = 0;
+	ledbar_blink(0x0000);
+	ledbar_set(0x0000);
 }
 
 // ########################################################################################
-// CANVAS: Read joystick and perform action
+// CANVAS: Read joystick events and perform action
 // ########################################################################################
 void readJoystick() {
-	uint8_t state = 0;
-	state = joystick_read();
-	if (state != 0)
-		drawOled(state);
+	JoyEvent event;
+	if (joyinput_getEvent(&event))
+		drawOled(&event);
 }
 
 // ########################################################################################
 // CANVAS: Draw on OLED based on joystick
 // ########################################################################################
-static void drawOled(uint8_t joyState) {
-    static int wait = 0;
-    uint8_t data;
+static void drawOled(JoyEvent *event) {
     static int isDrawing = 1;
 
-    if ((joyState & JOYSTICK_CENTER && !isJoystickDebounced) != 0) {
+    if ((event->pressed & JOYSTICK_CENTER) != 0) {
         isDrawing = !isDrawing;
-        isJoystickDebounced = 1;
-        joystickDebounceTask->runCount = 0;
-        addTask(fastTaskList, &fastTaskCount, joystickDebounceTask);
-        return;
     }
 
-    if (wait++ < 3)
-        return;
-
-    wait = 0;
-
-    if ((joyState & JOYSTICK_UP) != 0 && currY > 0) {
-        currY--;
-
-        if (isDrawing) {
-            data = 124;
-            UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-            sendControlSeq(left);
-        }
-        sendControlSeq(up);
+    for (; event->dy < 0; event->dy++) {
+        canvas_step(CANVAS_UP, isDrawing);
     }
 
-    if ((joyState & JOYSTICK_DOWN) != 0 && currY < OLED_DISPLAY_HEIGHT-1) {
-        currY++;
-
-        if (isDrawing) {
-            data = 124;
-            UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-            sendControlSeq(left);
-        }
-        sendControlSeq(down);
+    for (; event->dy > 0; event->dy--) {
+        canvas_step(CANVAS_DOWN, isDrawing);
     }
 
-    if ((joyState & JOYSTICK_RIGHT) != 0 && currX < OLED_DISPLAY_WIDTH-1) {
-        currX++;
-
-        if (isDrawing) {
-            data = 45;
-            UART_Send(LPC_UART3, &data, 1, BLOCKING);
-        } else {
-        	sendControlSeq(right);
-        }
-
+    for (; event->dx > 0; event->dx--) {
+        canvas_step(CANVAS_RIGHT, isDrawing);
     }
 
-    if ((joyState & JOYSTICK_LEFT) != 0 && currX > 0) {
-        currX--;
-
-        if (isDrawing) {
-            data = 45;
-            UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-            sendControlSeq(left);
-        }
-        sendControlSeq(left);
+    for (; event->dx < 0; event->dx++) {
+        canvas_step(CANVAS_LEFT, isDrawing);
     }
 
-    if (lastX != currX || lastY != currY) {
-        oled_putPixel(currX, currY, OLED_COLOR_WHITE);
-        if (!isDrawing) {
-        	oled_putPixel(lastX, lastY, OLED_COLOR_BLACK);
-        }
-        lastX = currX;
-        lastY = currY;
-    }
+    // Send all moves of this frame at once
+    term_flush();
 }
 
 // ########################################################################################
-// CANVAS: Joystick debounce callback
+// MUSIC: Advance song sequencer
 // ########################################################################################
-void joystickDebounceTimeout() {
-	isJoystickDebounced = 0;
+void tickSong() {
+	song_tick(tickMillis);
 }
 
 // ########################################################################################
-// MUSIC: Play a note
-// ########################################################################################
-static void playNote(uint32_t note, uint32_t durationMs) {
-
-    uint32_t t = 0;
-
-    if (note > 0) {
-
-        while (t < (durationMs*1000)) {
-            NOTE_PIN_HIGH();
-            Timer0_us_Wait(note / 2);
-            //delay32Us(0, note / 2);
-
-            NOTE_PIN_LOW();
-            Timer0_us_Wait(note / 2);
-            //delay32Us(0, note / 2);
-
-            t += note;
-        }
-
-    }
-    else {
-    	Timer0_Wait(durationMs);
-        //delay32Ms(0, durationMs);
-    }
-}
-
-// ########################################################################################
-// MUSIC: Get note
-// ########################################################################################
-static uint32_t getNote(uint8_t ch)
-{
-    if (ch >= 'A' && ch <= 'G')
-        return notes[ch - 'A'];
-
-    if (ch >= 'a' && ch <= 'g')
-        return notes[ch - 'a' + 7];
-
-    return 0;
-}
-
-// ########################################################################################
-// MUSIC: Get duration of note
-// ########################################################################################
-static uint32_t getDuration(uint8_t ch)
-{
-    if (ch < '0' || ch > '9')
-        return 400;
-
-    /* number of ms */
-
-    return (ch - '0') * 200;
-}
-
-// ########################################################################################
-// MUSIC: Get duration of pause
-// ########################################################################################
-static uint32_t getPause(uint8_t ch)
-{
-    switch (ch) {
-    case '+':
-        return 0;
-    case ',':
-        return 5;
-    case '.':
-        return 20;
-    case '_':
-        return 30;
-    default:
-        return 5;
-    }
-}
-
-// ########################################################################################
-// MUSIC: Play a song based on a string of characters
-// ########################################################################################
-static void playSong(uint8_t *song) {
-    uint32_t note = 0;
-    uint32_t dur  = 0;
-    uint32_t pause = 0;
-
-    /*
-     * A song is a collection of tones where each tone is
-     * a note, duration and pause, e.g.
-     *
-     * "E2,F4,"
-     */
-
-    while(*song != '\0') {
-        note = getNote(*song++);
-        if (*song == '\0')
-            break;
-        dur  = getDuration(*song++);
-        if (*song == '\0')
-            break;
-        pause = getPause(*song++);
-
-        playNote(note, dur);
-        //delay32Ms(0, pause);
-        Timer0_Wait(pause);
-
-    }
+// MUSIC: Play, loop or set tempo from a line typed at home
+// ########################################################################################
+static void playSongLine(uint8_t *line) {
+	char queueFull[] = "Song queue is full\n\r";
+
+	switch (line[0]) {
+		case '@':
+			song_setTempo(atoi((char *)line+1));
+			break;
+		case '!':
+			song_stop();
+			break;
+		case '*':
+			if (!song_queue(line+1, 1))
+				term_write(queueFull);
+			break;
+		default:
+			if (!song_queue(line, 0))
+				term_write(queueFull);
+			break;
+	}
 }
 
 // ########################################################################################
@@ -871,15 +903,6 @@ static void playSong(uint8_t *song) {
 // ########################################################################################
 void EINT3_IRQHandler(void)
 {
-//	int i;
-	// Determine whether GPIO Interrupt P2.10 has occurred (SW3)
-	if ((LPC_GPIOINT->IO2IntStatF>>10)& 0x1)
-	{
-		sw3Interrupt();
-
-        // Clear GPIO Interrupt P2.10
-        LPC_GPIOINT->IO2IntClr = 1<<10;
-	}
 	// Determine whether GPIO Interrupt P2.5 has occurred (Light sensor)
 	if ((LPC_GPIOINT->IO2IntStatF>>5)& 0x1)
 	{
@@ -888,15 +911,18 @@ void EINT3_IRQHandler(void)
         // Clear GPIO Interrupt P2.5
         LPC_GPIOINT->IO2IntClr = 1<<5;
 	}
+	// Determine whether GPIO Interrupt P0.2 has occurred (Temperature sensor)
+	if ((LPC_GPIOINT->IO0IntStatR>>2)& 0x1)
+	{
+		tempsense_edgeHandler();
+	}
 }
 
 // ########################################################################################
-// Interrupt (Common): when trigger button (SW3) is pressed
+// Debounce (Common): when trigger button (SW3) is pressed
 // ########################################################################################
-void sw3Interrupt() {
-	Task *triggerSensorTask = newTask(&getSensorValues, 0, 1, TICK_MILLIS);
-	triggerSensorTask->runCount = 0;
-	addTask(slowTaskList, &slowTaskCount, triggerSensorTask);
+void sw3Pressed() {
+	isSensorReportRequested = 1;
 }
 
 // ########################################################################################
@@ -911,29 +937,40 @@ static void lightningInterruptHandler()
 	{
 		lightningStartTicks = msTicks;
 		light_setHiThreshold(RANGE_K2-1); // Disable high threshold
-		light_setLoThreshold(LIGHTNING_THRESHOLD);
+		light_setLoThreshold(lightningThreshold);
 
 		if (curMode == SURVIVAL) {
-			resetLEDSeqTask->repeatCount = -1; // Start resetting LED
-			addTask(fastTaskList, &fastTaskCount, resetLEDSeqTask);
+			// Hold the countdown and flash all LEDs
+			isLEDSeqHeld = 1;
+			resetLEDSeq();
+			ledbar_set(ledOn);
+			ledbar_blink(0xffff);
 		}
 	} else {
-		if (msTicks-lightningStartTicks<LIGHTNING_THRESHOLD_TIME) {
+		if (msTicks-lightningStartTicks<lightningThresholdTime) {
 			lightningCount++;
+			flashlog_append(LOG_LIGHTNING, lightningCount, 0, 0);
 			if (curMode == EXPLORER && lightningCount >= 3) {
 				prevMode = curMode;
 				curMode = SURVIVAL;
 				hasModeChanged = 1;
 			}
 			Task *lightningTimeoutTask;
-			lightningTimeoutTask = newTask(&lightningTimeout, LIGHTNING_TIME_WINDOW-(msTicks-lightningStartTicks), 1, TICK_MILLIS);
-			addTask(fastTaskList, &fastTaskCount, lightningTimeoutTask);
+			lightningTimeoutTask = newTask(&lightningTimeout, lightningTimeWindow-(msTicks-lightningStartTicks), 1, tickMillis);
+			if (lightningTimeoutTask != NULL) {
+				// Only needed once, so the slot is freed when it is done
+				lightningTimeoutTask->isTemporary = 1;
+				if (!addTask(&fastTaskList, lightningTimeoutTask))
+					lightningTimeoutTask->task = NULL; // List full, give the slot back
+			}
 			updateLightningCount();
 		}
 		if (curMode == SURVIVAL) {
-			resetLEDSeqTask->repeatCount = 0; // Stop resetting LED
+			// Release the countdown
+			isLEDSeqHeld = 0;
+			ledbar_blink(0x0000);
 		}
-		light_setHiThreshold(LIGHTNING_THRESHOLD);
+		light_setHiThreshold(lightningThreshold);
 		light_setLoThreshold(0); // Disable low threshold
 	}
 	lightningStatus = !lightningStatus;
@@ -949,9 +986,19 @@ void TIMER0_IRQHandler(void) {
 	TIM_ResetCounter(LPC_TIM0);
 	TIM_Cmd(LPC_TIM0, ENABLE);
 
+	// Debounce buttons and keystrokes
+	debounce_service();
+
 	// Run tasks from fast list
-	removeFinishedTasks(fastTaskList, &fastTaskCount);
-	checkAndRunTasks(fastTaskList, &fastTaskCount);
+	removeFinishedTasks(&fastTaskList);
+	checkAndRunTasks(&fastTaskList);
+}
+
+// ########################################################################################
+// CANVAS: Keeps the main loop's watchdog deadline away during a long redraw or export
+// ########################################################################################
+static void canvasBusy() {
+	watchdog_extend(CANVAS_GRACE);
 }
 
 // ########################################################################################
@@ -967,44 +1014,53 @@ void UART3_IRQHandler(void) {
 // ########################################################################################
 void UART3ReceiveInterruptHandler() {
 	uint8_t input = 0;
-	uint8_t data = 0;
-	uint32_t len = 0;
-	uint8_t song[MAX_SONG_LENGTH];
 
 	// Receives a character
 	UART_Receive(LPC_UART3, &input, 1, NONE_BLOCKING);
 
-	if (!isUARTDebounced) {
-		isUARTDebounced = 1;
-		UARTDebounceTask->runCount = 0;
-		addTask(fastTaskList, &fastTaskCount, UARTDebounceTask);
+	// Framed commands from a host skip the menus and the debounce
+	if (cmd_receive(input))
+		return;
+
+	// Menus write to the terminal, which only the main loop may do; drop keys if it is behind
+	if ((uint8_t)(keyHead-keyTail) < KEY_QUEUE_LENGTH) {
+		keyQueue[keyHead % KEY_QUEUE_LENGTH] = input;
+		keyHead++;
+	}
+}
+
+// ########################################################################################
+// Acts on a keystroke from home in the menus, canvas or music mode (main loop)
+// ########################################################################################
+static void handleKey(uint8_t input) {
+	uint8_t data = 0;
+
+	if (debounce_accept(UARTDebounceId)) {
 
 		switch (curMenuPos) {
 		//Main menu
 			case 0:
-				// Clear
-				sendControlSeq(clear);
-				//Home
-				sendControlSeq(home);
+				// Clear and home
+				term_clear();
 
 				switch (input) {
 					case '1':
 						prevMode = curMode;
 						curMode = STARTER;
 						hasModeChanged = 1;
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+						term_write(menu[curMenuPos]);
 						break;
 					case '2':
 						prevMode = curMode;
 						curMode = EXPLORER;
 						hasModeChanged = 1;
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+						term_write(menu[curMenuPos]);
 						break;
 					case '3':
 						prevMode = curMode;
 						curMode = SURVIVAL;
 						hasModeChanged = 1;
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+						term_write(menu[curMenuPos]);
 						break;
 					case '4':
 						curMenuPos = 1;
@@ -1013,26 +1069,20 @@ void UART3ReceiveInterruptHandler() {
 						hasModeChanged = 1;
 
 						// Information
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
-
-						// Center
-						sendControlSeq(center);
+						term_write(menu[curMenuPos]);
 
-						// Reset OLED
-						currX = 48;
-						currY = 32;
-						lastX = 0;
-						lastY = 0;
+						// Redraw what was drawn before
+						canvas_replayTerminal();
 						break;
 					case '5':
 						curMenuPos = 2;
 						prevMode = curMode;
 						curMode = MUSIC;
 						hasModeChanged = 1;
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+						term_write(menu[curMenuPos]);
 						break;
 					default:
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+						term_write(menu[curMenuPos]);
 						break;
 				}
 				break;
@@ -1040,82 +1090,54 @@ void UART3ReceiveInterruptHandler() {
 			case 1:
 				switch (input) {
 					case 'w':
-						// Draw on teraterm
-						data = '|';
-						UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-						sendControlSeq(left);
-						sendControlSeq(up);
-
-						// Draw on OLED
-						currY--;
-						oled_putPixel(currX, currY, OLED_COLOR_WHITE);
-						lastY = currY;
+						canvas_step(CANVAS_UP, 1);
 						break;
 					case 'a':
-						// Draw on teraterm
-						data = '-';
-						UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-						sendControlSeq(left);
-						sendControlSeq(left);
-
-						// Draw on OLED
-						currX--;
-						oled_putPixel(currX, currY, OLED_COLOR_WHITE);
-						lastX = currX;
+						canvas_step(CANVAS_LEFT, 1);
 						break;
 					case 's':
-						// Draw on teraterm
-						data = '|';
-						UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-						sendControlSeq(left);
-						sendControlSeq(down);
-
-						// Draw on OLED
-						currY++;
-						oled_putPixel(currX, currY, OLED_COLOR_WHITE);
-						lastY = currY;
+						canvas_step(CANVAS_DOWN, 1);
 						break;
 					case 'd':
-						// Draw on teraterm
-						data = '-';
-						UART_Send(LPC_UART3, &data, 1, BLOCKING);
-
-						// Draw on OLED
-						currX++;
-						oled_putPixel(currX, currY, OLED_COLOR_WHITE);
-						lastX = currX;
+						canvas_step(CANVAS_RIGHT, 1);
 						break;
 					case 'i':
-						currY--;
-						lastY = currY;
-						sendControlSeq(up);
+						canvas_step(CANVAS_UP, 0);
 						break;
 					case 'j':
-						currX--;
-						lastX = currX;
-						sendControlSeq(left);
+						canvas_step(CANVAS_LEFT, 0);
 						break;
 					case 'k':
-						currY++;
-						lastY = currY;
-						sendControlSeq(down);
+						canvas_step(CANVAS_DOWN, 0);
 						break;
 					case 'l':
-						currX++;
-						lastX = currX;
-						sendControlSeq(right);
+						canvas_step(CANVAS_RIGHT, 0);
+						break;
+					case 'r':
+						// Resync teraterm and OLED with the canvas
+						term_clear();
+						term_write(menu[curMenuPos]);
+						canvas_replayTerminal();
+						canvas_replayOled();
+						break;
+					case 'x':
+						// Export canvas to home
+						canvas_export();
+						break;
+					case 'c':
+						// Clear canvas
+						canvas_reset();
+						term_clear();
+						term_write(menu[curMenuPos]);
+						canvas_replayTerminal();
+						canvas_replayOled();
 						break;
 					case 'q':
-						// Clear
-						sendControlSeq(clear);
-						//Home
-						sendControlSeq(home);
+						// Clear and home
+						term_clear();
 
 						curMenuPos = 0;
-						UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+						term_write(menu[curMenuPos]);
 						// Stop canvas mode
 						stopCanvas();
 						curMode = -1;
@@ -1123,46 +1145,44 @@ void UART3ReceiveInterruptHandler() {
 					default:
 						break;
 				}
-				isUARTDebounced = 0; // Don't debounce
+				term_flush();
+				debounce_release(UARTDebounceId); // Don't debounce
 				break;
 			// Music
 			case 2:
-				if (input == 'q') {
-					// Clear
-					sendControlSeq(clear);
-					//Home
-					sendControlSeq(home);
+				if (input == 'q' && songLineLength == 0) {
+					// Clear and home
+					term_clear();
 
 					curMenuPos = 0;
-					UART_Send(LPC_UART3, (uint8_t *)menu[curMenuPos] , strlen(menu[curMenuPos]), BLOCKING);
+					term_write(menu[curMenuPos]);
 
 					// Quit music mode
 					stopMusic();
 					curMode = -1;
 				} else {
-					// Receive string to play
-					len = 1;
-					song[0] = input;
+					// Receive string to play one character at a time
 					UART_Send(LPC_UART3, &input, 1, BLOCKING);
-					do {
-						UART_Receive(LPC_UART3, &data, 1, BLOCKING);
-						UART_Send(LPC_UART3, &data, 1, BLOCKING);
-						if (data != '\r') {
-							len++;
-							song[len-1] = data;
+					if (input != '\r') {
+						if (songLineLength < MAX_SONG_LENGTH-2) {
+							songLine[songLineLength++] = input;
 						}
-					} while ((len<MAX_SONG_LENGTH) && (data != '\r'));
-					song[len]=',';
-					song[len+1]=0;
-					// Break line
-					data = 10;
-					UART_Send(LPC_UART3, &data, 1, BLOCKING);
-					playSong(song);
+					} else {
+						songLine[songLineLength++] = ',';
+						songLine[songLineLength] = 0;
+						// Break line
+						data = 10;
+						UART_Send(LPC_UART3, &data, 1, BLOCKING);
+						playSongLine(songLine);
+						songLineLength = 0;
+					}
 				}
+				debounce_release(UARTDebounceId); // Don't debounce
 				break;
 			default:
 				break;
 		}
+		term_flush();
 	}
 }
 
@@ -1189,6 +1209,7 @@ uint32_t getTicks(void) {
 // ########################################################################################
 void SysTick_Handler(void) {
 	msTicks++;
+	watchdog_check();
 }
 
 // ########################################################################################
@@ -1230,6 +1251,7 @@ void stopCanvas() {
 	// Blank Oled
 	blankOLED();
 	// Stop reading joystick
+	sampleJoystickTask->repeatCount = 0;
 	readJoystickTask->repeatCount = 0;
 }
 
@@ -1237,11 +1259,11 @@ void stopCanvas() {
 // MUSIC: Stop music mode
 // ########################################################################################
 void stopMusic() {
-    /* ---- Speaker ------> */
-    GPIO_SetDir(0, 1<<27, 0);
-    GPIO_SetDir(0, 1<<28, 0);
-    GPIO_SetDir(2, 1<<13, 0);
-    /* <---- Speaker ------ */
+	// Stop sequencer
+	song_stop();
+	synth_stop();
+	playSongTask->repeatCount = 0;
+	songLineLength = 0;
 }
 
 // ########################################################################################
@@ -1250,20 +1272,24 @@ void stopMusic() {
 void startStarter() {
 	// Remove blinking led
 	if (isBlinking) {
-		blinkRGBTask->repeatCount = 0;
 		isBlinking = 0;
+		sampleAccTask->repeatCount = 0;
+		sampleSensorsTask->repeatCount = 0;
 		blankRGBLED();
 	}
 	// Blank 7 segment
 	blank7Seg();
 	// Blank Oled
 	blankOLED();
-    // Add starting sequence task
+    // Add starting sequence task, and the animation, which waits for its cue
 	curSeqIndex = 0;
-    showStartingSeqTask->repeatCount = seqLength+1;
-    showStartingSeqTask->runCount = 0;
+	COROUTINE_RESTART(&startingSeqCo);
+    showStartingSeqTask->repeatCount = -1;
 	runTaskOnce(showStartingSeqTask);
-	addTask(fastTaskList, &fastTaskCount, showStartingSeqTask);
+	addTask(&fastTaskList, showStartingSeqTask);
+	COROUTINE_RESTART(&startingAniCo);
+	showStartingAniTask->repeatCount = -1;
+	addTask(&fastTaskList, showStartingAniTask);
 }
 
 // ########################################################################################
@@ -1276,18 +1302,22 @@ void startExplorer() {
 		initGPIOInterrupt();
 		// Enable lightning detector
 		enableLightningDetector();
-		// Set RGB led to blink blue
-		blinkRGBTask->repeatCount = -1;
-		runTaskOnce(blinkRGBTask);
-		addTask(fastTaskList, &fastTaskCount, blinkRGBTask);
+		// Start watching the accelerometer
+		accel_getEvents();
+		sampleAccTask->repeatCount = -1;
+		addTask(&slowTaskList, sampleAccTask);
+		// Keep sensor snapshots fresh in the background
+		sensors_invalidate();
+		sampleSensorsTask->repeatCount = -1;
+		addTask(&slowTaskList, sampleSensorsTask);
 		isBlinking = 1; // Run only once
 	}
 	// Change RGB color to blue
 	setRGBLEDColor(RGB_BLUE);
-	// Get sensor values every SAMPLING_TIME
+	// Get sensor values every samplingTime
 	getSensorValuesTask->repeatCount = -1;
 	runTaskOnce(getSensorValuesTask);
-	addTask(slowTaskList, &slowTaskCount, getSensorValuesTask);
+	addTask(&slowTaskList, getSensorValuesTask);
 }
 
 // ########################################################################################
@@ -1300,10 +1330,14 @@ void startSurvival() {
 		initGPIOInterrupt();
 		// Enable lightning detector
 		enableLightningDetector();
-		// Set RGB led to blink blue
-		blinkRGBTask->repeatCount = -1;
-		runTaskOnce(blinkRGBTask);
-		addTask(fastTaskList, &fastTaskCount, blinkRGBTask);
+		// Start watching the accelerometer
+		accel_getEvents();
+		sampleAccTask->repeatCount = -1;
+		addTask(&slowTaskList, sampleAccTask);
+		// Keep sensor snapshots fresh in the background
+		sensors_invalidate();
+		sampleSensorsTask->repeatCount = -1;
+		addTask(&slowTaskList, sampleSensorsTask);
 		isBlinking = 1; // Run only once
 	}
 	// Blank sensor values
@@ -1312,10 +1346,9 @@ void startSurvival() {
 	setRGBLEDColor(RGB_RED);
 	// Reset and show sequence
 	resetLEDSeq();
-	showLEDSeqTask->repeatCount = NUM_OF_LED+2;
-	showLEDSeqTask->runCount = 0;
+	showLEDSeqTask->repeatCount = -1;
 	runTaskOnce(showLEDSeqTask);
-	addTask(fastTaskList, &fastTaskCount, showLEDSeqTask);
+	addTask(&fastTaskList, showLEDSeqTask);
 }
 
 // ########################################################################################
@@ -1324,18 +1357,23 @@ void startSurvival() {
 void startCanvas() {
 	// Remove blinking led
 	if (isBlinking) {
-		blinkRGBTask->repeatCount = 0;
 		isBlinking = 0;
+		sampleAccTask->repeatCount = 0;
+		sampleSensorsTask->repeatCount = 0;
 		blankRGBLED();
 	}
 	// Blank 7 segment
 	blank7Seg();
-	// Blank Oled
-	blankOLED();
+	// Show what was drawn before
+	canvas_replayOled();
+	isOLEDOn = 1;
 
 	// Start reading Joystick
+	joyinput_reset();
+	sampleJoystickTask->repeatCount = -1;
+	addTask(&fastTaskList, sampleJoystickTask);
 	readJoystickTask->repeatCount = -1;
-	addTask(slowTaskList, &slowTaskCount, readJoystickTask);
+	addTask(&slowTaskList, readJoystickTask);
 }
 
 // ########################################################################################
@@ -1344,8 +1382,9 @@ void startCanvas() {
 void startMusic() {
 	// Remove blinking led
 	if (isBlinking) {
-		blinkRGBTask->repeatCount = 0;
 		isBlinking = 0;
+		sampleAccTask->repeatCount = 0;
+		sampleSensorsTask->repeatCount = 0;
 		blankRGBLED();
 	}
 	// Blank 7 segment
@@ -1356,56 +1395,489 @@ void startMusic() {
     /* ---- Speaker ------> */
     GPIO_SetDir(2, 1<<0, 1);
     GPIO_SetDir(2, 1<<1, 1);
+    /* <---- Speaker ------ */
 
-    GPIO_SetDir(0, 1<<27, 1);
-    GPIO_SetDir(0, 1<<28, 1);
-    GPIO_SetDir(2, 1<<13, 1);
-    GPIO_SetDir(0, 1<<26, 1);
+    // Start sequencer; synth_start drives the LM4811
+    synth_start();
+    playSongTask->repeatCount = -1;
+    addTask(&fastTaskList, playSongTask);
+}
 
-    GPIO_ClearValue(0, 1<<27); //LM4811-clk
-    GPIO_ClearValue(0, 1<<28); //LM4811-up/dn
-    GPIO_ClearValue(2, 1<<13); //LM4811-shutdn
-    /* <---- Speaker ------ */
+// ########################################################################################
+// Parameter: sensor report interval changed
+// ########################################################################################
+static void samplingTimeChanged() {
+	setTaskInterval(getSensorValuesTask, samplingTime, tickMillis);
+}
+
+// ########################################################################################
+// Parameter: keystroke debounce changed
+// ########################################################################################
+static void debounceTimeChanged() {
+	debounce_setThreshold(UARTDebounceId, debounceTime/tickMillis);
+}
+
+// ########################################################################################
+// Parameter: tick length changed, retime TIMER0 and everything counted in ticks
+// ########################################################################################
+static void tickMillisChanged() {
+	TIM_UpdateMatchValue(LPC_TIM0, 0, tickMillis);
+	setTaskTick(tickMillis);
+	setTaskInterval(playSongTask, tickMillis, tickMillis);
+	debounce_setThreshold(sw3DebounceId, SW3_DEBOUNCE_TIME/tickMillis);
+	debounceTimeChanged();
+}
+
+// ########################################################################################
+// Parameter: temperature calibration changed
+// ########################################################################################
+static void tempOffsetChanged() {
+	tempsense_setOffset(tempOffset);
+}
+
+static const Param params[] = {
+		{"SAMPLING_TIME", PARAM_TYPE_INT32, &samplingTime, 100, 60000, &samplingTimeChanged},
+		{"LIGHTNING_THRESHOLD", PARAM_TYPE_INT32, &lightningThreshold, 1, RANGE_K2-2, NULL},
+		{"LIGHTNING_TIME", PARAM_TYPE_INT32, &lightningThresholdTime, 10, 10000, NULL},
+		{"LIGHTNING_WINDOW", PARAM_TYPE_INT32, &lightningTimeWindow, 100, 60000, NULL},
+		{"TIME_UNIT", PARAM_TYPE_UINT16, &timeUnit, 50, 5000, NULL},
+		{"TICK_MILLIS", PARAM_TYPE_UINT8, &tickMillis, 1, 20, &tickMillisChanged},
+		{"DEBOUNCE_TIME", PARAM_TYPE_UINT16, &debounceTime, 0, 5000, &debounceTimeChanged},
+		{"TEMP_OFFSET", PARAM_TYPE_INT32, &tempOffset, -200, 200, &tempOffsetChanged}
+};
+
+// ########################################################################################
+// Common: Write " NAME=XXXXXXXX" for a crash dump register
+// ########################################################################################
+static char *fmtRegister(char *out, const char *name, uint32_t value) {
+	out = fmt_str(fmt_char(out, ' '), name);
+	return fmt_hex(fmt_char(out, '='), value, 8);
+}
+
+// ########################################################################################
+// Common: Send the crash dump from before the last reset, if there is one
+// ########################################################################################
+void reportCrash() {
+	const CrashDump *crash = crash_getLast();
+	const char *taskName;
+	char line[96], *end;
+	int word;
+
+	if (crash == NULL) {
+		// The WDT ran out without a dump, so an interrupt hung
+		if (watchdog_wasReset()) {
+			term_write("CRASH WATCHDOG TASK=NONE\r\n");
+			flashlog_append(LOG_CRASH, CRASH_WATCHDOG, 0xFF, 0);
+		}
+		return;
+	}
+	flashlog_append(LOG_CRASH, crash->type, crash->task == CRASH_NO_TASK ? 0xFF : crash->task, 0);
+	if (crash->type == CRASH_WATCHDOG) {
+		taskName = watchdog_getName(crash->task);
+		fmt_str(fmt_str(fmt_str(line, "CRASH WATCHDOG TASK="), taskName != NULL ? taskName : "UNKNOWN"), "\r\n");
+		term_write(line);
+		return;
+	}
+	end = fmt_str(fmt_str(line, "CRASH "), faultNames[crash->type <= CRASH_WATCHDOG ? crash->type : 0]);
+	end = fmtRegister(end, "SP", crash->sp);
+	end = fmtRegister(end, "EXC_RETURN", crash->excReturn);
+	fmt_str(fmt_str(end, crash->isFrameValid ? "" : " BAD_SP"), "\r\n");
+	term_write(line);
+	end = fmtRegister(fmt_str(line, "CRASH"), "PC", crash->pc);
+	end = fmtRegister(end, "LR", crash->lr);
+	fmt_str(fmtRegister(end, "PSR", crash->xpsr), "\r\n");
+	term_write(line);
+	end = fmtRegister(fmt_str(line, "CRASH"), "R0", crash->r0);
+	end = fmtRegister(end, "R1", crash->r1);
+	end = fmtRegister(end, "R2", crash->r2);
+	end = fmtRegister(end, "R3", crash->r3);
+	fmt_str(fmtRegister(end, "R12", crash->r12), "\r\n");
+	term_write(line);
+	end = fmtRegister(fmt_str(line, "CRASH"), "CFSR", crash->cfsr);
+	end = fmtRegister(end, "HFSR", crash->hfsr);
+	end = fmtRegister(end, "MMFAR", crash->mmfar);
+	fmt_str(fmtRegister(end, "BFAR", crash->bfar), "\r\n");
+	term_write(line);
+	// Stack above the frame, 8 words a line
+	for (word=0;word<CRASH_STACK_WORDS;word++) {
+		if (word%8 == 0)
+			end = fmt_str(line, "CRASH STACK");
+		end = fmt_hex(fmt_char(end, ' '), crash->stack[word], 8);
+		if (word%8 == 7 || word == CRASH_STACK_WORDS-1) {
+			fmt_str(end, "\r\n");
+			term_write(line);
+		}
+	}
+}
+
+// ########################################################################################
+// Command: MODE <name> - switches mode without going through the menu
+// ########################################################################################
+static int modeCommand(char *args, char *reply) {
+	int mode;
+	for (mode=STARTER;mode<=MUSIC;mode++) {
+		if (strcmp(args, modeNames[mode]) == 0) {
+			curMenuPos = (mode == CANVAS) ? 1 : (mode == MUSIC) ? 2 : 0;
+			songLineLength = 0;
+			prevMode = curMode;
+			curMode = mode;
+			hasModeChanged = 1;
+			return CMD_OK;
+		}
+	}
+	strcpy(reply, "BAD_MODE");
+	return CMD_ERR;
+}
+
+// ########################################################################################
+// Command: SET <name> <value> - changes a setting
+// ########################################################################################
+static int setCommand(char *args, char *reply) {
+	int param;
+	char *valueStr, *end;
+	long value;
+
+	valueStr = strchr(args, ' ');
+	if (valueStr == NULL) {
+		strcpy(reply, "NO_VALUE");
+		return CMD_ERR;
+	}
+	*valueStr++ = '\0';
+	if ((param = params_find(args)) == PARAMS_NOT_FOUND) {
+		strcpy(reply, "BAD_NAME");
+		return CMD_ERR;
+	}
+	value = strtol(valueStr, &end, 10);
+	if (end == valueStr || *end != '\0' || params_set(param, value) != PARAM_OK) {
+		strcpy(reply, "BAD_VALUE");
+		return CMD_ERR;
+	}
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: GET <name> - reads a setting, the mode or the lightning count
+// ########################################################################################
+static int getCommand(char *args, char *reply) {
+	int param;
+
+	if (strcmp(args, "MODE") == 0) {
+		strcpy(reply, (curMode >= STARTER && curMode <= MUSIC) ? modeNames[curMode] : "NONE");
+	} else if (strcmp(args, "LIGHTNING_COUNT") == 0) {
+		fmt_int(reply, lightningCount);
+	} else if ((param = params_find(args)) != PARAMS_NOT_FOUND) {
+		fmt_int(reply, params_get(param));
+	} else {
+		strcpy(reply, "BAD_NAME");
+		return CMD_ERR;
+	}
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: SAVE - keeps the parameters in flash over resets
+// ########################################################################################
+static int saveCommand(char *args, char *reply) {
+	if (!params_save()) {
+		strcpy(reply, "FLASH");
+		return CMD_ERR;
+	}
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: DEFAULTS - puts the parameters back to the values built into the program
+// ########################################################################################
+static int defaultsCommand(char *args, char *reply) {
+	params_restoreDefaults();
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: LOG DUMP <from> <count> | LOG INFO | LOG FLUSH | LOG ERASE - reads the flash log
+// ########################################################################################
+static int logCommand(char *args, char *reply) {
+	char line[40];
+	char *end;
+	uint32_t index, last;
+	long count;
+	LogRecord record;
+
+	if (strcmp(args, "INFO") == 0) {
+		reply = fmt_uint(fmt_str(reply, "FIRST="), flashlog_getFirstIndex());
+		reply = fmt_uint(fmt_str(reply, " NEXT="), flashlog_getNextIndex());
+		reply = fmt_uint(fmt_str(reply, " DROPPED="), flashlog_getDroppedCount());
+		fmt_uint(fmt_str(reply, " ERASE_WAIT="), flashlog_getEraseDroppedCount());
+	} else if (strcmp(args, "FLUSH") == 0) {
+		flashlog_flush();
+	} else if (strcmp(args, "ERASE") == 0) {
+		flashlog_erase();
+	} else if (strncmp(args, "DUMP ", 5) == 0) {
+		index = strtoul(args+5, &end, 10);
+		count = strtol(end, &end, 10);
+		if (*end != '\0' || count <= 0) {
+			strcpy(reply, "BAD_RANGE");
+			return CMD_ERR;
+		}
+		if (count > MAX_LOG_DUMP)
+			count = MAX_LOG_DUMP;
+		if (index < flashlog_getFirstIndex())
+			index = flashlog_getFirstIndex();
+		last = index+count;
+		if (last > flashlog_getNextIndex())
+			last = flashlog_getNextIndex();
+
+		// One line per record: index time type data, skipping padding and lost records
+		for (count=0;index<last;index++) {
+			if (flashlog_read(index, &record)) {
+				end = fmt_uint(fmt_char(fmt_uint(line, index), ' '), record.time);
+				end = fmt_hex(fmt_char(end, ' '), record.type, 2);
+				end = fmt_hex(fmt_char(end, ' '), record.data[0], 2);
+				end = fmt_hex(end, record.data[1], 2);
+				fmt_str(fmt_hex(end, record.data[2], 2), "\r\n");
+				term_write(line);
+				watchdog_extend(LOG_DUMP_GRACE);
+				count++;
+			}
+		}
+		fmt_int(reply, count);
+	} else {
+		strcpy(reply, "BAD_ARGS");
+		return CMD_ERR;
+	}
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: STATS - uptime, task and command counters
+// ########################################################################################
+static int statsCommand(char *args, char *reply) {
+	reply = fmt_uint(fmt_str(reply, "UP="), msTicks);
+	reply = fmt_int(fmt_str(reply, " TASKS="), fastTaskList.count);
+	reply = fmt_int(fmt_char(reply, '/'), slowTaskList.count);
+	reply = fmt_uint(fmt_str(reply, " CMDS="), cmd_getReceivedCount());
+	fmt_uint(fmt_str(reply, " ERRS="), cmd_getErrorCount());
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: CRASH - the fault or late task that caused the last reset, or NONE
+// ########################################################################################
+static int crashCommand(char *args, char *reply) {
+	const CrashDump *crash = crash_getLast();
+
+	if (crash == NULL) {
+		strcpy(reply, "NONE");
+	} else if (crash->type == CRASH_WATCHDOG) {
+		fmt_str(fmt_str(reply, "WATCHDOG TASK="),
+				watchdog_getName(crash->task) != NULL ? watchdog_getName(crash->task) : "UNKNOWN");
+	} else {
+		reply = fmt_str(reply, faultNames[crash->type <= CRASH_WATCHDOG ? crash->type : 0]);
+		reply = fmtRegister(reply, "PC", crash->pc);
+		reply = fmtRegister(reply, "LR", crash->lr);
+		reply = fmtRegister(reply, "CFSR", crash->cfsr);
+		fmtRegister(reply, "HFSR", crash->hfsr);
+	}
+	return CMD_OK;
+}
+
+// ########################################################################################
+// Command: BOOT - microseconds from reset to each boot checkpoint, -1 if not reached yet
+// ########################################################################################
+static int bootCommand(char *args, char *reply) {
+	static const char *checkpointNames[BOOT_CHECKPOINTS] = {"MEM", "CLK", "CORE", "MODE", "DEV", "TLM"};
+	int checkpoint;
+	uint32_t micros;
+
+	// Longest reply is 6 names, 6 ten digit numbers and 5 spaces, inside CMD_REPLY_SIZE
+	for (checkpoint=0;checkpoint<BOOT_CHECKPOINTS;checkpoint++) {
+		if (checkpoint > 0)
+			reply = fmt_char(reply, ' ');
+		reply = fmt_char(fmt_str(reply, checkpointNames[checkpoint]), '=');
+		micros = boot_getMicros(checkpoint);
+		reply = (micros == BOOT_NOT_REACHED) ? fmt_int(reply, -1) : fmt_uint(reply, micros);
+	}
+	return CMD_OK;
+}
+
+#ifdef BENCHMARK
+// Task layout the scheduler used before TaskList, one pointer per task, to time against it
+typedef struct BenchTask
+{
+	void (*task)();
+	int interval;
+	int repeatCount;
+	int runCount;
+	int ticksBeforeRun;
+	int tickCount;
+	int tickGeneration;
+	int isScheduled;
+	uint32_t lastRun;
+	int isTemporary;
+} BenchTask;
+
+static int benchGeneration = 0;
+
+// ########################################################################################
+// BENCH: does nothing, for tasks that are only there to be scanned
+// ########################################################################################
+static void benchIdle() {
+}
+
+// ########################################################################################
+// BENCH: one tick of the scheduler as it was before TaskList
+// ########################################################################################
+static void __attribute__((noinline)) benchPointerTick(BenchTask **taskList, int taskCount) {
+	int taskNum;
+	for (taskNum=0;taskNum<taskCount;taskNum++) {
+		if (taskList[taskNum]->tickGeneration != benchGeneration) {
+			taskList[taskNum]->ticksBeforeRun = taskList[taskNum]->interval/tickMillis;
+			taskList[taskNum]->tickGeneration = benchGeneration;
+		}
+		taskList[taskNum]->tickCount++;
+		if (taskList[taskNum]->tickCount >= taskList[taskNum]->ticksBeforeRun) {
+			taskList[taskNum]->tickCount = 0;
+			taskList[taskNum]->task();
+		}
+	}
+}
+
+// ########################################################################################
+// BENCH FMT: average cycles to build a telemetry line with snprintf and with fmt
+// ########################################################################################
+static void benchFmt(char *reply) {
+	char line[TELEMETRY_SIZE];
+	volatile int l = 3999, t = -123, x = -128, y = 5, z = 64; // volatile so nothing is worked out at compile time
+	uint32_t start, snprintfCycles, fmtCycles;
+	int count;
+
+	start = boot_getCycleCount();
+	for (count=0;count<BENCH_LINES;count++)
+		snprintf(line, sizeof(line), "L%d_T%d.%d_AX%d_AY%d_AZ%d\r\n", l, t/10, t%10, x, y, z);
+	snprintfCycles = (boot_getCycleCount()-start)/BENCH_LINES;
+
+	start = boot_getCycleCount();
+	for (count=0;count<BENCH_LINES;count++)
+		formatTelemetry(line, l, t, x, y, z);
+	fmtCycles = (boot_getCycleCount()-start)/BENCH_LINES;
+
+	reply = fmt_uint(fmt_str(reply, "SNPRINTF="), snprintfCycles);
+	fmt_uint(fmt_str(reply, " FMT="), fmtCycles);
 }
 
+// ########################################################################################
+// BENCH TASKS: average cycles for a tick of a full task list with nothing due, with
+// TaskList and with the pointer per task layout it replaced
+// ########################################################################################
+static void benchTasks(char *reply) {
+	static Task tasks[TASK_LIST_SIZE];
+	static TaskList taskList;
+	static BenchTask pointerTasks[TASK_LIST_SIZE];
+	static BenchTask *pointerList[TASK_LIST_SIZE];
+	uint32_t start, listCycles, pointerCycles;
+	int count;
+
+	taskList.count = 0;
+	for (count=0;count<TASK_LIST_SIZE;count++) {
+		tasks[count].task = &benchIdle;
+		tasks[count].repeatCount = -1;
+		tasks[count].isScheduled = 0; // Left set by the last run, whose list was just emptied
+		setTaskInterval(&tasks[count], BENCH_TASK_INTERVAL, tickMillis);
+		addTask(&taskList, &tasks[count]);
+
+		pointerTasks[count].task = &benchIdle;
+		pointerTasks[count].interval = BENCH_TASK_INTERVAL;
+		pointerTasks[count].ticksBeforeRun = BENCH_TASK_INTERVAL/tickMillis;
+		pointerTasks[count].tickCount = 0;
+		pointerTasks[count].tickGeneration = benchGeneration;
+		pointerList[count] = &pointerTasks[count];
+	}
+	checkAndRunTasks(&taskList); // Takes the new intervals outside the timing
+
+	start = boot_getCycleCount();
+	for (count=0;count<BENCH_TICKS;count++)
+		checkAndRunTasks(&taskList);
+	listCycles = (boot_getCycleCount()-start)/BENCH_TICKS;
+
+	start = boot_getCycleCount();
+	for (count=0;count<BENCH_TICKS;count++)
+		benchPointerTick(pointerList, TASK_LIST_SIZE);
+	pointerCycles = (boot_getCycleCount()-start)/BENCH_TICKS;
+
+	reply = fmt_uint(fmt_str(reply, "LIST="), listCycles);
+	fmt_uint(fmt_str(reply, " POINTERS="), pointerCycles);
+}
+
+// ########################################################################################
+// Command: BENCH FMT|TASKS - times the formatting or the scheduler against what it replaced
+// ########################################################################################
+static int benchCommand(char *args, char *reply) {
+	if (strcmp(args, "FMT") == 0) {
+		benchFmt(reply);
+	} else if (strcmp(args, "TASKS") == 0) {
+		benchTasks(reply);
+	} else {
+		strcpy(reply, "BAD_BENCH");
+		return CMD_ERR;
+	}
+	return CMD_OK;
+}
+#endif
+
+static const Command commands[] = {
+		{"MODE", &modeCommand},
+		{"SET", &setCommand},
+		{"GET", &getCommand},
+		{"SAVE", &saveCommand},
+		{"DEFAULTS", &defaultsCommand},
+		{"LOG", &logCommand},
+		{"STATS", &statsCommand},
+		{"BOOT", &bootCommand},
+		{"CRASH", &crashCommand},
+#ifdef BENCHMARK
+		{"BENCH", &benchCommand},
+#endif
+};
+
 // ########################################################################################
 // Main function
 // ########################################################################################
 int main (void) {
 
+	// Keep any crash dump from the last run before anything else can fault
+	crash_init();
+
     // Initialization functions
     init_i2c();
     init_ssp();
     init_GPIO();
 	init_uart();
 
+    // OLED, sensors, joystick and speaker wait for bringUpDevices
     pca9532_init();
-    joystick_init();
-    acc_init();
-    oled_init();
     led7seg_init();
     rgb_init();
-    temp_init(&getTicks);
-    light_enable();
+    rgb_initPwm();
+    sensors_init(&getTicks);
+    flashlog_init(&getTicks);
+    flashlog_append(LOG_BOOT, curMode, 0, 0);
 
 	// Setup SysTick Timer to interrupt at 1 msec intervals
 	SysTick_Config(SystemCoreClock / 1000);
 
+	// Register inputs to debounce before the tick starts
+	UARTDebounceId = debounce_registerEvent(debounceTime/tickMillis);
+	sw3DebounceId = debounce_registerLevel(&readSW3, &sw3Pressed, SW3_DEBOUNCE_TIME/tickMillis);
+
 	// Initialize timer interrupts
 	initTimerInterrupt();
-	// Initialize UART interrupts
+	// Initialize command protocol before UART interrupts
+	cmd_init(commands, sizeof(commands)/sizeof(commands[0]));
+	canvas_setBusyHook(&canvasBusy);
 	initUARTInterrupt();
-	// Get initial z-value
-	int8_t xDiscard, yDiscard;
-    acc_read(&xDiscard, &yDiscard, &zInitial);
-    // Set light sensor range
-    light_setRange(LIGHT_RANGE_4000);
-    // Disable lightning detector at start
-    disableLightningDetector();
     // Show starting menu
-    sendControlSeq(clear);
-    sendControlSeq(home);
-    UART_Send(LPC_UART3, (uint8_t *)menu[0] , strlen(menu[0]), BLOCKING);
+    term_clear();
+    term_write(menu[0]);
     // Initialize stripes array
     int count;
 	srand(time(NULL));
@@ -1414,21 +1886,29 @@ int main (void) {
     	stripesY[count] = rand() % 64;
     }
 
-    // Initialize tasks
-    showStartingSeqTask = newTask(&showStartingSeq, 1000, seqLength+1, TICK_MILLIS);
-    showStartingAniTask = newTask(&showStartingAni, 50, 120, TICK_MILLIS);
-    blinkRGBTask = newTask(&blinkRGBLED, 1000, -1, TICK_MILLIS);
-    getSensorValuesTask = newTask(&getSensorValues, SAMPLING_TIME, -1, TICK_MILLIS);
-    resetLEDSeqTask = newTask(&resetLEDSeq, TICK_MILLIS, -1, TICK_MILLIS);
-    showLEDSeqTask = newTask(&showLEDSeq, TIME_UNIT, NUM_OF_LED+2, TICK_MILLIS);
-    UARTDebounceTask = newTask(&UARTDebounceTimeout, DEBOUNCE_TIME, 1, TICK_MILLIS);
-    readJoystickTask = newTask(&readJoystick, 1, -1, TICK_MILLIS);
-    joystickDebounceTask = newTask(&joystickDebounceTimeout, DEBOUNCE_TIME, 1, TICK_MILLIS);
+    // Time task runs for the watchdog
+    setTaskClock(&getTicks);
+    addTask(&slowTaskList, scroll7SegTask);
+
+    // Apply parameters saved in flash now that everything they change exists
+    params_init(params, sizeof(params)/sizeof(params[0]));
+    params_load();
+
+    // Sensor sampling and the main loop must keep running, or the watchdog resets
+    watchdog_watch(sampleSensorsTask, "SENSORS", SENSORS_WATCH_DEADLINE);
+    watchdog_watch(sampleAccTask, "ACCEL", ACCEL_WATCH_DEADLINE);
+    watchdog_watch(measureTempTask, "TEMP", TEMP_WATCH_DEADLINE);
+    watchdog_watch(scroll7SegTask, "MAIN_LOOP", MAIN_LOOP_WATCH_DEADLINE);
+    // Tell home if the last run ended in a fault or a hang
+    reportCrash();
+    watchdog_init(&getTicks);
+    boot_checkpoint(BOOT_CORE);
 
     while (1) {
     	// Respond to mode changes
     	if (hasModeChanged) {
     		if (prevMode != curMode) {
+    			flashlog_append(LOG_MODE, curMode, 0, 0);
     			switch (prevMode) {
 					case STARTER:
 						stopStarter();
@@ -1448,6 +1928,10 @@ int main (void) {
 					default:
 						break;
 				}
+				// Bring up what the new mode needs before starting it
+				if (curMode >= STARTER && curMode <= MUSIC) {
+					bringUpDevices(modeDevices[curMode]);
+				}
 				switch (curMode) {
 					case STARTER:
 						startStarter();
@@ -1467,15 +1951,54 @@ int main (void) {
 					default:
 						break;
 				}
+				boot_checkpoint(BOOT_MODE);
     		}
         	hasModeChanged = 0;
+    	} else if (readyDevices != DEVICE_ALL) {
+    		// Bring up the rest while nothing else is happening
+    		bringUpNextDevice();
+    	}
+
+    	// Send sensor values when SW3 is pressed
+    	if (isSensorReportRequested) {
+    		isSensorReportRequested = 0;
+    		if (curMode == EXPLORER || curMode == SURVIVAL) {
+    			reportSensorValues(SW3_REPORT_MAX_AGE);
+    		}
     	}
 
+    	// Act on keystrokes from home
+    	while (keyTail != keyHead) {
+    		handleKey(keyQueue[keyTail % KEY_QUEUE_LENGTH]);
+    		keyTail++;
+    	}
+
+    	// Run commands from home
+    	cmd_poll();
+
+    	// Send accelerometer events as they happen
+    	if (isBlinking) {
+    		reportAccEvents();
+    	}
+
+    	// Write full log pages to flash
+    	flashlog_service();
+
+    	// Erase the next log sector while nothing is waiting and no song needs its DMA refills,
+    	// as the erase holds off interrupts for about 100 ms. Log pages wait until it is done.
+    	if (!hasModeChanged && keyTail == keyHead && !isSensorReportRequested && curMode != MUSIC) {
+    		flashlog_eraseAhead();
+    	}
+
+    	// Write LED and 7 segment changes made by tasks and interrupts
+    	ledbar_update();
+    	seg7_update();
+
     	// Run tasks from slow list
-    	if(msTicks-curTicks >= TICK_MILLIS) {
+    	if(msTicks-curTicks >= tickMillis) {
     		curTicks = msTicks;
-    		removeFinishedTasks(slowTaskList, &slowTaskCount);
-    		checkAndRunTasks(slowTaskList, &slowTaskCount);
+    		removeFinishedTasks(&slowTaskList);
+    		checkAndRunTasks(&slowTaskList);
     	}
 
     }
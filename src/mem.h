@@ -0,0 +1,29 @@
+/*****************************************************************************
+ * Memory placement header file
+ *
+ * The LPC1768 has two 32K banks. RamLoc32 (0x10000000) sits on the CPU's
+ * local bus and holds the stack, the heap and anything the ISRs touch every
+ * tick. RamAHB32 (0x2007c000) is on the AHB matrix, which the GPDMA can
+ * reach and RamLoc32 cannot, so DMA buffers must go there. Bulk buffers that
+ * are only touched now and then go there too to leave room in RamLoc32.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef MEM_H_
+#define MEM_H_
+
+// Zeroed at reset, like normal .bss
+#define MEM_AHB_BSS __attribute__((section(".bss.$RAM2")))
+// Copied from flash at reset, like normal .data
+#define MEM_AHB_DATA __attribute__((section(".data.$RAM2")))
+// Left alone at reset; the owner must initialise it
+#define MEM_AHB_NOINIT __attribute__((section(".noinit.$RAM2")))
+
+// Left alone at reset, in RamLoc32
+#define MEM_NOINIT __attribute__((section(".noinit")))
+
+#endif /* MEM_H_ */
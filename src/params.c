@@ -0,0 +1,196 @@
+/*****************************************************************************
+ * Parameter registry functions
+ *
+ * Tuning values live in ordinary variables owned by their modules. The
+ * registry knows where each one is, its type and its limits, so it can be
+ * read and changed by name at run time and anything that depends on it can be
+ * updated straight away. The whole set can be saved to the last flash sector
+ * and is loaded from there at start up; defaults are whatever the variables
+ * held when the registry was set up.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "params.h"
+#include "mem.h"
+#include "iap.h"
+#include <string.h>
+#include <stddef.h>
+
+#define PARAMS_MAGIC 0x50524D31 // "PRM1"
+
+// Saved image, one flash page
+typedef union ParamsImage
+{
+	struct
+	{
+		uint32_t magic;
+		uint32_t layout; // Changes if names, types or order of the table change
+		uint32_t count;
+		int32_t values[PARAMS_MAX];
+		uint32_t checksum;
+	} fields;
+	uint32_t words[IAP_PAGE_SIZE/4];
+} ParamsImage;
+
+static const Param *params;
+static int paramCount = 0;
+static int32_t defaults[PARAMS_MAX];
+static ParamsImage image MEM_AHB_BSS; // Flash is written from RAM, so the image is built here
+
+// ########################################################################################
+// Reads the variable a parameter points at
+// ########################################################################################
+static int32_t readValue(const Param *param) {
+	switch (param->type) {
+		case PARAM_TYPE_UINT8:
+			return *(uint8_t *)param->value;
+		case PARAM_TYPE_UINT16:
+			return *(uint16_t *)param->value;
+		default:
+			return *(int32_t *)param->value;
+	}
+}
+
+// ########################################################################################
+// Writes the variable a parameter points at
+// ########################################################################################
+static void writeValue(const Param *param, int32_t value) {
+	switch (param->type) {
+		case PARAM_TYPE_UINT8:
+			*(uint8_t *)param->value = value;
+			break;
+		case PARAM_TYPE_UINT16:
+			*(uint16_t *)param->value = value;
+			break;
+		default:
+			*(int32_t *)param->value = value;
+			break;
+	}
+}
+
+// ########################################################################################
+// Returns a hash of the table layout, so a saved image is not applied to another table
+// ########################################################################################
+static uint32_t getLayout() {
+	uint32_t hash = 5381;
+	const char *ch;
+	int i;
+
+	for (i=0;i<paramCount;i++) {
+		for (ch=params[i].name;*ch;ch++)
+			hash = hash*33+*ch;
+		hash = hash*33+params[i].type;
+	}
+	return hash;
+}
+
+// ########################################################################################
+// Returns checksum of every word in an image before the checksum
+// ########################################################################################
+static uint32_t getChecksum(const ParamsImage *source) {
+	const uint32_t *word = (const uint32_t *)source;
+	uint32_t sum = 0;
+	int i;
+
+	for (i=0;i<(int)(offsetof(ParamsImage, fields.checksum)/4);i++)
+		sum = (sum << 1 | sum >> 31) ^ word[i];
+	return sum;
+}
+
+// ########################################################################################
+// Sets up the registry. The current values of the variables become the defaults.
+// ########################################################################################
+void params_init(const Param *table, int count) {
+	int i;
+
+	params = table;
+	paramCount = (count > PARAMS_MAX) ? PARAMS_MAX : count;
+	for (i=0;i<paramCount;i++)
+		defaults[i] = readValue(&params[i]);
+}
+
+// ########################################################################################
+// Returns index of the parameter called name, or PARAMS_NOT_FOUND
+// ########################################################################################
+int params_find(const char *name) {
+	int i;
+	for (i=0;i<paramCount;i++) {
+		if (strcmp(name, params[i].name) == 0)
+			return i;
+	}
+	return PARAMS_NOT_FOUND;
+}
+
+// ########################################################################################
+// Returns value of a parameter
+// ########################################################################################
+int32_t params_get(int index) {
+	return readValue(&params[index]);
+}
+
+// ########################################################################################
+// Changes a parameter and updates whatever depends on it
+// ########################################################################################
+int params_set(int index, int32_t value) {
+	const Param *param = &params[index];
+
+	if (value < param->min || value > param->max)
+		return PARAM_OUT_OF_RANGE;
+	if (value == readValue(param))
+		return PARAM_OK;
+
+	writeValue(param, value);
+	if (param->onChange != NULL)
+		param->onChange();
+	return PARAM_OK;
+}
+
+// ########################################################################################
+// Puts every parameter back to its default
+// ########################################################################################
+void params_restoreDefaults() {
+	int i;
+	for (i=0;i<paramCount;i++)
+		params_set(i, defaults[i]);
+}
+
+// ########################################################################################
+// Applies the values saved in flash. Returns 1 if there was a valid image.
+// ########################################################################################
+int params_load() {
+	const ParamsImage *saved = (const ParamsImage *)iap_sectorAddress(PARAMS_SECTOR);
+	int i;
+
+	if (saved->fields.magic != PARAMS_MAGIC || saved->fields.layout != getLayout()
+			|| saved->fields.count != paramCount || saved->fields.checksum != getChecksum(saved))
+		return 0;
+
+	for (i=0;i<paramCount;i++)
+		params_set(i, saved->fields.values[i]); // Out of range values keep the default
+	return 1;
+}
+
+// ########################################################################################
+// Saves every parameter to flash. Returns 1 on success.
+// ########################################################################################
+int params_save() {
+	int i;
+
+	memset(&image, 0xFF, sizeof(image));
+	image.fields.magic = PARAMS_MAGIC;
+	image.fields.layout = getLayout();
+	image.fields.count = paramCount;
+	for (i=0;i<paramCount;i++)
+		image.fields.values[i] = readValue(&params[i]);
+	image.fields.checksum = getChecksum(&image);
+
+	if (iap_erase(PARAMS_SECTOR, PARAMS_SECTOR) != IAP_CMD_SUCCESS)
+		return 0;
+	if (iap_write(PARAMS_SECTOR, iap_sectorAddress(PARAMS_SECTOR), image.words, sizeof(image)) != IAP_CMD_SUCCESS)
+		return 0;
+	return memcmp((const void *)iap_sectorAddress(PARAMS_SECTOR), &image, sizeof(image)) == 0;
+}
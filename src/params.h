@@ -0,0 +1,52 @@
+/*****************************************************************************
+ * Parameter registry header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef PARAMS_H_
+#define PARAMS_H_
+
+#include <stdint.h>
+
+#define PARAMS_MAX 16
+#define PARAMS_SECTOR 29 // Last 32K flash sector, 0x78000, kept out of the program by the linker script
+#define PARAMS_NOT_FOUND -1
+
+// Types of the variables parameters point at
+#define PARAM_TYPE_UINT8 0
+#define PARAM_TYPE_UINT16 1
+#define PARAM_TYPE_INT32 2
+
+// Results of params_set
+#define PARAM_OK 0
+#define PARAM_OUT_OF_RANGE 1
+
+typedef struct Param
+{
+	const char *name;
+	uint8_t type;
+	void *value;
+	int32_t min;
+	int32_t max;
+	void (*onChange)(); // Called after the value changes, NULL if nothing depends on it
+} Param;
+
+void params_init(const Param *table, int count);
+
+int params_find(const char *name);
+
+int32_t params_get(int index);
+
+int params_set(int index, int32_t value);
+
+void params_restoreDefaults();
+
+int params_load();
+
+int params_save();
+
+#endif /* PARAMS_H_ */
@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * Pin ownership functions
+ *
+ * Some base board pins are wired to two peripherals. A driver must claim such
+ * a pin before it changes its function or drives it, and release it when it
+ * is done, so that one driver cannot silently break the other.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "pinmux.h"
+
+#include "LPC17xx.h"
+
+static volatile int owners[PINMUX_SHARED_PINS] = {PINMUX_OWNER_NONE};
+
+// ########################################################################################
+// Claims pin for owner. Returns 1 if owner now has the pin, 0 if someone else has it.
+// ########################################################################################
+int pinmux_claim(int pin, int owner) {
+	int isClaimed = 0;
+	__disable_irq();
+	if (owners[pin] == PINMUX_OWNER_NONE || owners[pin] == owner) {
+		owners[pin] = owner;
+		isClaimed = 1;
+	}
+	__enable_irq();
+	return isClaimed;
+}
+
+// ########################################################################################
+// Releases pin if owner has it
+// ########################################################################################
+void pinmux_release(int pin, int owner) {
+	__disable_irq();
+	if (owners[pin] == owner) {
+		owners[pin] = PINMUX_OWNER_NONE;
+	}
+	__enable_irq();
+}
+
+// ########################################################################################
+// Returns 1 if owner has pin
+// ########################################################################################
+int pinmux_isOwner(int pin, int owner) {
+	return owners[pin] == owner;
+}
@@ -0,0 +1,28 @@
+/*****************************************************************************
+ * Pin ownership header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef PINMUX_H_
+#define PINMUX_H_
+
+// Pins used by more than one driver
+#define PINMUX_P0_26 0 // RGB blue (GPIO) and speaker (AOUT)
+#define PINMUX_SHARED_PINS 1
+
+// Owners
+#define PINMUX_OWNER_NONE 0
+#define PINMUX_OWNER_RGB 1
+#define PINMUX_OWNER_SPEAKER 2
+
+int pinmux_claim(int pin, int owner);
+
+void pinmux_release(int pin, int owner);
+
+int pinmux_isOwner(int pin, int owner);
+
+#endif /* PINMUX_H_ */
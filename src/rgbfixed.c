@@ -10,13 +10,28 @@
  * Includes
  *****************************************************************************/
 
+#include "lpc17xx_pinsel.h"
 #include "lpc17xx_gpio.h"
-#include "rgb.h"
+#include "lpc17xx_pwm.h"
+#include "rgbfixed.h"
+#include "pinmux.h"
 
 /******************************************************************************
  * Defines and typedefs
  *****************************************************************************/
 
+#define PWM_PCLK      25000000  /* CCLK/4 */
+#define PWM_PERIOD    255       /* MR0, levels are 0 to PWM_PERIOD */
+#define PWM_ALWAYS_ON (PWM_PERIOD+1)
+#define PWM_RED       1         /* P2.0 - PWM1.1 */
+#define PWM_GREEN     2         /* P2.1 - PWM1.2 */
+#define PWM_BLUE_OFF  3         /* MR3 turns blue off when blinking or dimmed */
+#define PWM_PRESCALE  (PWM_PCLK/((PWM_PERIOD+1)*RGB_PWM_FREQ) - 1)
+
+#define RED   0
+#define GREEN 1
+#define BLUE  2
+
 /******************************************************************************
  * External global variables
  *****************************************************************************/
@@ -25,10 +40,142 @@
  * Local variables
  *****************************************************************************/
 
+/* Perceived brightness to PWM duty cycle, gamma 2.2 */
+static const uint8_t gammaTable[RGB_MAX_LEVEL+1] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6,
+    6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+    12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+    20, 20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29,
+    30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39, 39, 40, 41,
+    42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+    73, 74, 75, 76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90,
+    91, 93, 94, 95, 97, 98, 99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+static int isPwmMode = 0;
+static volatile int isBlinking = 0;
+static uint8_t ledShadow = 0xFF;       /* Last mask written, 0xFF forces first write */
+static uint8_t levels[3];
+static uint8_t fadeFrom[3];
+static uint8_t fadeTarget[3];
+static volatile uint16_t fadeSteps = 0;
+static volatile uint16_t fadeStep = 0;
+static int isBlueOn = 0;
+static volatile int isBluePwm = 0;     /* Blue dimmed from the PWM interrupt */
+
 /******************************************************************************
  * Local Functions
  *****************************************************************************/
 
+/*
+ * Blue shares P0.26 with the speaker, so it is only an output while the
+ * RGB driver owns the pin.
+ */
+static void setBlue (int on)
+{
+    if (on) {
+        if (!pinmux_isOwner(PINMUX_P0_26, PINMUX_OWNER_RGB)) {
+            if (!pinmux_claim(PINMUX_P0_26, PINMUX_OWNER_RGB)) {
+                return;
+            }
+            GPIO_SetDir( 0, (1<<26), 1 );
+        }
+        GPIO_SetValue( 0, (1<<26) );
+        isBlueOn = 1;
+    } else if (pinmux_isOwner(PINMUX_P0_26, PINMUX_OWNER_RGB)) {
+        GPIO_ClearValue( 0, (1<<26) );
+        GPIO_SetDir( 0, (1<<26), 0 );
+        pinmux_release(PINMUX_P0_26, PINMUX_OWNER_RGB);
+        isBlueOn = 0;
+    }
+}
+
+static void configureMatch0 (FunctionalState intOnMatch)
+{
+    PWM_MATCHCFG_Type matchCfg;
+
+    matchCfg.MatchChannel = 0;
+    matchCfg.IntOnMatch = intOnMatch;
+    matchCfg.ResetOnMatch = ENABLE;
+    matchCfg.StopOnMatch = DISABLE;
+    PWM_ConfigMatch(LPC_PWM1, &matchCfg);
+}
+
+static void configureMatch3 (FunctionalState intOnMatch)
+{
+    PWM_MATCHCFG_Type matchCfg;
+
+    matchCfg.MatchChannel = PWM_BLUE_OFF;
+    matchCfg.IntOnMatch = intOnMatch;
+    matchCfg.ResetOnMatch = DISABLE;
+    matchCfg.StopOnMatch = DISABLE;
+    PWM_ConfigMatch(LPC_PWM1, &matchCfg);
+}
+
+static uint32_t getMatchValue (uint8_t level)
+{
+    if (level == RGB_MAX_LEVEL) {
+        return PWM_ALWAYS_ON;
+    }
+    return gammaTable[level];
+}
+
+/*
+ * Writes levels to the PWM channels, latched at the start of the next period.
+ * P0.26 has no PWM output, so a dimmed blue is turned on by MR0 at the start
+ * of each period and off again by MR3.
+ */
+static void applyLevels (void)
+{
+    uint32_t blueMatch = getMatchValue(levels[BLUE]);
+
+    PWM_MatchUpdate(LPC_PWM1, PWM_RED, getMatchValue(levels[RED]), PWM_MATCH_UPDATE_NEXT_RST);
+    PWM_MatchUpdate(LPC_PWM1, PWM_GREEN, getMatchValue(levels[GREEN]), PWM_MATCH_UPDATE_NEXT_RST);
+
+    if (blueMatch == 0 || blueMatch == PWM_ALWAYS_ON) {
+        if (isBluePwm) {
+            isBluePwm = 0;
+            configureMatch3(DISABLE);
+            if (fadeSteps == 0) {
+                configureMatch0(DISABLE);
+            }
+        }
+        if ((blueMatch != 0) != isBlueOn) {
+            setBlue(blueMatch != 0);
+        }
+        return;
+    }
+
+    PWM_MatchUpdate(LPC_PWM1, PWM_BLUE_OFF, blueMatch, PWM_MATCH_UPDATE_NEXT_RST);
+    if (!isBluePwm) {
+        isBluePwm = 1;
+        configureMatch0(ENABLE);
+        configureMatch3(ENABLE);
+    }
+}
+
+/* Leaves blinking, fading and dimmed blue and goes back to normal PWM frequency */
+static void stopAnimation (void)
+{
+    fadeSteps = 0;
+    isBluePwm = 0;
+    if (isBlinking) {
+        isBlinking = 0;
+        LPC_PWM1->PR = PWM_PRESCALE;
+        PWM_ResetCounter(LPC_PWM1);
+    }
+    configureMatch3(DISABLE);
+    configureMatch0(DISABLE);
+}
+
 /******************************************************************************
  * Public Functions
  *****************************************************************************/
@@ -42,16 +189,60 @@
 void rgb_init (void)
 {
     GPIO_SetDir( 2, 1, 1 );
-    GPIO_SetDir( 0, (1<<26), 1 );
     GPIO_SetDir( 2, (1<<1), 1 );
+    /* P0.26 is made an output by setBlue, while the RGB driver owns it */
 
 }
 
+/******************************************************************************
+ *
+ * Description:
+ *    Drive red and green from PWM1 instead of GPIO. P0.26 has no PWM
+ *    output, so blue stays on GPIO and is dimmed from the PWM interrupt.
+ *
+ *****************************************************************************/
+void rgb_initPwm (void)
+{
+    PINSEL_CFG_Type PinCfg;
+    PWM_TIMERCFG_Type pwmCfg;
+
+    /* P2.0 - PWM1.1, P2.1 - PWM1.2 */
+    PinCfg.Funcnum = 1;
+    PinCfg.OpenDrain = 0;
+    PinCfg.Pinmode = 0;
+    PinCfg.Portnum = 2;
+    PinCfg.Pinnum = 0;
+    PINSEL_ConfigPin(&PinCfg);
+    PinCfg.Pinnum = 1;
+    PINSEL_ConfigPin(&PinCfg);
+
+    pwmCfg.PrescaleOption = PWM_TIMER_PRESCALE_TICKVAL;
+    pwmCfg.PrescaleValue = PWM_PRESCALE+1;
+    PWM_Init(LPC_PWM1, PWM_MODE_TIMER, &pwmCfg);
+
+    PWM_MatchUpdate(LPC_PWM1, 0, PWM_PERIOD, PWM_MATCH_UPDATE_NOW);
+    configureMatch0(DISABLE);
+    PWM_ChannelConfig(LPC_PWM1, PWM_RED, PWM_CHANNEL_SINGLE_EDGE);
+    PWM_ChannelConfig(LPC_PWM1, PWM_GREEN, PWM_CHANNEL_SINGLE_EDGE);
+    PWM_MatchUpdate(LPC_PWM1, PWM_RED, 0, PWM_MATCH_UPDATE_NOW);
+    PWM_MatchUpdate(LPC_PWM1, PWM_GREEN, 0, PWM_MATCH_UPDATE_NOW);
+    PWM_ChannelCmd(LPC_PWM1, PWM_RED, ENABLE);
+    PWM_ChannelCmd(LPC_PWM1, PWM_GREEN, ENABLE);
+
+    PWM_ResetCounter(LPC_PWM1);
+    PWM_CounterCmd(LPC_PWM1, ENABLE);
+    PWM_Cmd(LPC_PWM1, ENABLE);
+    NVIC_EnableIRQ(PWM1_IRQn);
+
+    isPwmMode = 1;
+    ledShadow = 0xFF;
+}
+
 
 /******************************************************************************
  *
  * Description:
- *    Set LED states
+ *    Set LED states. Nothing is written if the LEDs are already in that state.
  *
  * Params:
  *    [in]  ledMask  - The mask is used to turn LEDs on or off
@@ -59,17 +250,27 @@ void rgb_init (void)
  *****************************************************************************/
 void rgb_setLeds (uint8_t ledMask)
 {
+    if (ledMask == ledShadow && !isBlinking && fadeSteps == 0) {
+        return;
+    }
+    ledShadow = ledMask;
+
+    if (isPwmMode) {
+        stopAnimation();
+        levels[RED] = ((ledMask & RGB_RED) != 0) ? RGB_MAX_LEVEL : 0;
+        levels[GREEN] = ((ledMask & RGB_GREEN) != 0) ? RGB_MAX_LEVEL : 0;
+        levels[BLUE] = ((ledMask & RGB_BLUE) != 0) ? RGB_MAX_LEVEL : 0;
+        applyLevels();
+        return;
+    }
+
     if ((ledMask & RGB_RED) != 0) {
         GPIO_SetValue( 2, 1);
     } else {
         GPIO_ClearValue( 2, 1 );
     }
 
-    if ((ledMask & RGB_BLUE) != 0) {
-        GPIO_SetValue( 0, (1<<26) );
-    } else {
-        GPIO_ClearValue( 0, (1<<26) );
-    }
+    setBlue((ledMask & RGB_BLUE) != 0);
 
     if ((ledMask & RGB_GREEN) != 0) {
         GPIO_SetValue( 2, (1<<1) );
@@ -78,3 +279,148 @@ void rgb_setLeds (uint8_t ledMask)
     }
 
 }
+
+/******************************************************************************
+ *
+ * Description:
+ *    Set brightness of each colour. Needs rgb_initPwm.
+ *
+ * Params:
+ *    [in]  red, green, blue  - 0 (off) to RGB_MAX_LEVEL
+ *
+ *****************************************************************************/
+void rgb_setIntensity (uint8_t red, uint8_t green, uint8_t blue)
+{
+    stopAnimation();
+    ledShadow = 0xFF;
+    levels[RED] = red;
+    levels[GREEN] = green;
+    levels[BLUE] = blue;
+    applyLevels();
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Fade from the current brightness to a new one. Each PWM period the
+ *    PWM interrupt latches the next step, so no task is needed. Needs
+ *    rgb_initPwm.
+ *
+ * Params:
+ *    [in]  red, green, blue  - 0 (off) to RGB_MAX_LEVEL
+ *    [in]  timeMs            - Length of the fade
+ *
+ *****************************************************************************/
+void rgb_fadeTo (uint8_t red, uint8_t green, uint8_t blue, uint16_t timeMs)
+{
+    uint32_t steps = ((uint32_t)timeMs*RGB_PWM_FREQ)/1000;
+
+    stopAnimation();
+    ledShadow = 0xFF;
+    if (steps == 0) {
+        rgb_setIntensity(red, green, blue);
+        return;
+    }
+
+    fadeFrom[RED] = levels[RED];
+    fadeFrom[GREEN] = levels[GREEN];
+    fadeFrom[BLUE] = levels[BLUE];
+    fadeTarget[RED] = red;
+    fadeTarget[GREEN] = green;
+    fadeTarget[BLUE] = blue;
+    fadeStep = 0;
+    fadeSteps = (steps > 0xFFFF) ? 0xFFFF : steps;
+    configureMatch0(ENABLE);
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    Blink LEDs in hardware. The PWM period is stretched to the blink period
+ *    so red and green blink on their own. Blue is switched at the start and
+ *    middle of the period by the PWM interrupt. Needs rgb_initPwm.
+ *
+ * Params:
+ *    [in]  steadyMask  - LEDs that stay on
+ *    [in]  blinkMask   - LEDs that blink, half of the period on
+ *    [in]  periodMs    - Blink period, from 1 ms; 0 is ignored
+ *
+ *****************************************************************************/
+void rgb_blink (uint8_t steadyMask, uint8_t blinkMask, uint16_t periodMs)
+{
+    uint32_t matchValues[3];
+    int i;
+    uint8_t masks[3] = {RGB_RED, RGB_GREEN, RGB_BLUE};
+
+    /* The prescaler would wrap round */
+    if (periodMs == 0) {
+        return;
+    }
+
+    stopAnimation();
+    ledShadow = 0xFF;
+
+    for (i = 0; i < 3; i++) {
+        if ((blinkMask & masks[i]) != 0) {
+            matchValues[i] = (PWM_PERIOD+1)/2;
+        } else if ((steadyMask & masks[i]) != 0) {
+            matchValues[i] = PWM_ALWAYS_ON;
+        } else {
+            matchValues[i] = 0;
+        }
+        levels[i] = (matchValues[i] != 0) ? RGB_MAX_LEVEL : 0;
+    }
+
+    LPC_PWM1->PR = ((PWM_PCLK/1000)*periodMs)/(PWM_PERIOD+1) - 1;
+    PWM_MatchUpdate(LPC_PWM1, PWM_RED, matchValues[RED], PWM_MATCH_UPDATE_NOW);
+    PWM_MatchUpdate(LPC_PWM1, PWM_GREEN, matchValues[GREEN], PWM_MATCH_UPDATE_NOW);
+    PWM_MatchUpdate(LPC_PWM1, PWM_BLUE_OFF, (PWM_PERIOD+1)/2, PWM_MATCH_UPDATE_NOW);
+    PWM_ResetCounter(LPC_PWM1);
+    isBlinking = 1;
+
+    if ((blinkMask & RGB_BLUE) != 0) {
+        setBlue(1);
+        configureMatch0(ENABLE);
+        configureMatch3(ENABLE);
+    } else {
+        setBlue((steadyMask & RGB_BLUE) != 0);
+    }
+}
+
+/******************************************************************************
+ *
+ * Description:
+ *    PWM1 interrupt. MR0 starts each period: it steps a fade, and turns blue
+ *    on when blinking or dimmed. MR3 turns blue off halfway through a blink
+ *    or at its level when dimmed.
+ *
+ *****************************************************************************/
+void PWM1_IRQHandler (void)
+{
+    int i;
+
+    if (PWM_GetIntStatus(LPC_PWM1, PWM_INTSTAT_MR0)) {
+        PWM_ClearIntPending(LPC_PWM1, PWM_INTSTAT_MR0);
+        if (isBlinking || isBluePwm) {
+            setBlue(1);
+        }
+        if (!isBlinking && fadeSteps > 0) {
+            fadeStep++;
+            for (i = 0; i < 3; i++) {
+                levels[i] = fadeFrom[i] + (((int32_t)fadeTarget[i]-fadeFrom[i])*fadeStep)/fadeSteps;
+            }
+            if (fadeStep >= fadeSteps) {
+                fadeSteps = 0;
+            }
+            applyLevels();
+            if (fadeSteps == 0 && !isBluePwm) {
+                configureMatch0(DISABLE);
+            }
+        }
+    }
+
+    if (PWM_GetIntStatus(LPC_PWM1, PWM_INTSTAT_MR3)) {
+        PWM_ClearIntPending(LPC_PWM1, PWM_INTSTAT_MR3);
+        setBlue(0);
+    }
+}
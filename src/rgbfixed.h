@@ -8,14 +8,22 @@
 #ifndef __RGB_H
 #define __RGB_H
 
+#include <stdint.h>
 
 #define RGB_RED   0x01
 #define RGB_BLUE  0x02
 #define RGB_GREEN 0x04
 
+#define RGB_PWM_FREQ 1000   /* Hz, PWM frequency when not blinking */
+#define RGB_MAX_LEVEL 255
+
 
 void rgb_init (void);
+void rgb_initPwm (void);
 void rgb_setLeds (uint8_t ledMask);
+void rgb_setIntensity (uint8_t red, uint8_t green, uint8_t blue);
+void rgb_fadeTo (uint8_t red, uint8_t green, uint8_t blue, uint16_t timeMs);
+void rgb_blink (uint8_t steadyMask, uint8_t blinkMask, uint16_t periodMs);
 
 
 #endif /* end __RGB_H */
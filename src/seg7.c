@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * 7 segment display functions
+ *
+ * Characters are turned into segment patterns from a fixed table and sent to
+ * the display in raw mode. Like the LED bar, callers only set what should be
+ * shown; seg7_update writes it from the main loop, and only when the pattern
+ * differs from what is already on the display. Numbers wider than one digit
+ * are scrolled a digit at a time by seg7_scroll.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "seg7.h"
+
+#include "lpc_types.h"
+#include "led7seg.h"
+
+// Segment patterns for the EA display, active low
+#define GLYPH_BLANK 0xFF
+#define GLYPH_DASH 0xFB
+#define GLYPH_UNKNOWN 0x00 // All segments and the dot, never shown
+
+static const uint8_t hexGlyphs[16] = {
+	0x24, 0xAF, 0xE0, 0xA2, 0x2B, 0x32, 0x30, 0xA7, // 0-7
+	0x20, 0x22, 0x21, 0x38, 0x74, 0xA8, 0x70, 0x71  // 8-9, A-F
+};
+
+static volatile uint8_t frames[SEG7_MAX_FRAMES];
+static volatile int frameCount = 1;
+static volatile int curFrame = 0;
+static uint8_t writtenGlyph = GLYPH_UNKNOWN;
+
+// ########################################################################################
+// Returns segment pattern for a character, blank if it cannot be shown
+// ########################################################################################
+static uint8_t getGlyph(char ch) {
+	if (ch >= '0' && ch <= '9')
+		return hexGlyphs[ch-'0'];
+	if (ch >= 'A' && ch <= 'F')
+		return hexGlyphs[ch-'A'+10];
+	if (ch >= 'a' && ch <= 'f')
+		return hexGlyphs[ch-'a'+10];
+	if (ch == '-')
+		return GLYPH_DASH;
+	return GLYPH_BLANK;
+}
+
+// ########################################################################################
+// Shows a single pattern and stops any scrolling
+// ########################################################################################
+static void showGlyph(uint8_t glyph) {
+	frameCount = 1;
+	curFrame = 0;
+	frames[0] = glyph;
+}
+
+// ########################################################################################
+// Shows a character
+// ########################################################################################
+void seg7_showChar(char ch) {
+	showGlyph(getGlyph(ch));
+}
+
+// ########################################################################################
+// Shows a number, scrolling it if it has more than one digit
+// ########################################################################################
+void seg7_showNumber(uint16_t value) {
+	uint8_t digits[5];
+	int digitCount = 0, count = 0;
+
+	if (value < 10) {
+		showGlyph(hexGlyphs[value]);
+		return;
+	}
+
+	do {
+		digits[digitCount++] = value%10;
+		value /= 10;
+	} while (value > 0);
+
+	// Most significant digit first, with a gap between repeated digits so 11 is not 1
+	while (digitCount-- > 0) {
+		if (count > 0 && frames[count-1] == hexGlyphs[digits[digitCount]])
+			frames[count++] = GLYPH_BLANK;
+		frames[count++] = hexGlyphs[digits[digitCount]];
+	}
+	frames[count++] = GLYPH_BLANK; // Marks where the number starts again
+	curFrame = 0;
+	frameCount = count;
+}
+
+// ########################################################################################
+// Blanks the display
+// ########################################################################################
+void seg7_blank() {
+	showGlyph(GLYPH_BLANK);
+}
+
+// ########################################################################################
+// Moves a scrolling number on by one digit; run every SEG7_SCROLL_TIME
+// ########################################################################################
+void seg7_scroll() {
+	if (frameCount > 1)
+		curFrame = (curFrame+1)%frameCount;
+}
+
+// ########################################################################################
+// Writes the current pattern to the display if it has changed; run from the main loop
+// ########################################################################################
+void seg7_update() {
+	uint8_t glyph = frames[curFrame%frameCount];
+
+	if (glyph == writtenGlyph)
+		return;
+
+	led7seg_setChar(glyph, TRUE);
+	writtenGlyph = glyph;
+}
@@ -0,0 +1,28 @@
+/*****************************************************************************
+ * 7 segment display header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef SEG7_H_
+#define SEG7_H_
+
+#include <stdint.h>
+
+#define SEG7_SCROLL_TIME 500 // Time each digit of a long number is shown
+#define SEG7_MAX_FRAMES 12 // Digits of a uint16_t with gaps, plus trailing blank
+
+void seg7_showChar(char ch);
+
+void seg7_showNumber(uint16_t value);
+
+void seg7_blank();
+
+void seg7_scroll();
+
+void seg7_update();
+
+#endif /* SEG7_H_ */
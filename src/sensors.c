@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * Sensor cache functions
+ *
+ * Keeps one timestamped snapshot per sensor. A background task refreshes all
+ * of them at a fixed rate, and each consumer says how old a value it will
+ * accept; a sensor is only read again when its snapshot is older than that.
+ * Reports that come close together, such as a periodic report and a button
+ * press, then share one set of I2C reads.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "sensors.h"
+#include "tempsense.h"
+#include "accel.h"
+
+#include "light.h"
+
+static SensorSnapshot snapshots[SENSOR_COUNT];
+static uint32_t (*getTicks)(void);
+
+// ########################################################################################
+// Reads a sensor into its snapshot
+// ########################################################################################
+static void acquire(int sensor) {
+	SensorSnapshot *snapshot = &snapshots[sensor];
+	AccelSummary acc;
+	int32_t temp;
+
+	switch (sensor) {
+		case SENSOR_LIGHT:
+			snapshot->value[0] = light_read();
+			break;
+		case SENSOR_TEMP:
+			// No reading yet; value[0] keeps the last good one, if any
+			temp = tempsense_read();
+			if (temp == TEMPSENSE_INVALID) {
+				snapshot->isValid = 0;
+				return;
+			}
+			snapshot->value[0] = temp;
+			break;
+		case SENSOR_ACC:
+			accel_getSummary(&acc);
+			snapshot->value[0] = acc.x;
+			snapshot->value[1] = acc.y;
+			snapshot->value[2] = acc.z;
+			break;
+		default:
+			return;
+	}
+	snapshot->time = getTicks();
+	snapshot->isValid = 1;
+}
+
+// ########################################################################################
+// Sets the ms tick source used to timestamp snapshots
+// ########################################################################################
+void sensors_init(uint32_t (*getMsTicks)(void)) {
+	getTicks = getMsTicks;
+	sensors_invalidate();
+}
+
+// ########################################################################################
+// Marks every snapshot as stale, so the next read of each sensor goes to the sensor
+// ########################################################################################
+void sensors_invalidate() {
+	int sensor;
+	for (sensor=0;sensor<SENSOR_COUNT;sensor++) {
+		snapshots[sensor].isValid = 0;
+	}
+}
+
+// ########################################################################################
+// Refreshes every sensor; run every SENSORS_SAMPLE_TIME
+// ########################################################################################
+void sensors_sample() {
+	int sensor;
+	for (sensor=0;sensor<SENSOR_COUNT;sensor++) {
+		acquire(sensor);
+	}
+}
+
+// ########################################################################################
+// Returns snapshot of sensor, reading it first if the snapshot is older than maxAge ms
+// ########################################################################################
+const SensorSnapshot *sensors_get(int sensor, uint32_t maxAge) {
+	SensorSnapshot *snapshot = &snapshots[sensor];
+
+	if (!snapshot->isValid || getTicks()-snapshot->time > maxAge) {
+		acquire(sensor);
+	}
+	return snapshot;
+}
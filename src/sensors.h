@@ -0,0 +1,38 @@
+/*****************************************************************************
+ * Sensor cache header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef SENSORS_H_
+#define SENSORS_H_
+
+#include <stdint.h>
+
+#define SENSORS_SAMPLE_TIME 1000 // Background sampler refreshes every sensor this often
+
+// Sensors
+#define SENSOR_LIGHT 0 // value[0] in lux
+#define SENSOR_TEMP 1 // value[0] in tenths of a degree C
+#define SENSOR_ACC 2 // value[0..2] are x, y and z
+#define SENSOR_COUNT 3
+
+typedef struct SensorSnapshot
+{
+	int32_t value[3];
+	uint32_t time; // ms tick when the snapshot was taken
+	uint8_t isValid;
+} SensorSnapshot;
+
+void sensors_init(uint32_t (*getMsTicks)(void));
+
+void sensors_invalidate();
+
+void sensors_sample();
+
+const SensorSnapshot *sensors_get(int sensor, uint32_t maxAge);
+
+#endif /* SENSORS_H_ */
@@ -0,0 +1,235 @@
+/*****************************************************************************
+ * Song functions
+ *
+ * Songs are compiled once from text into an array of note events and played
+ * by a sequencer that is ticked from the scheduler. Notes are played by the
+ * DAC synth, so playing never blocks.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "song.h"
+#include "mem.h"
+#include "synth.h"
+
+#include "LPC17xx.h"
+
+#define NOTE_ATTACK_TIME 5
+#define NOTE_RELEASE_TIME 20
+
+static const uint16_t notes[] = {
+        2272, // A - 440 Hz
+        2024, // B - 494 Hz
+        3816, // C - 262 Hz
+        3401, // D - 294 Hz
+        3030, // E - 330 Hz
+        2865, // F - 349 Hz
+        2551, // G - 392 Hz
+        1136, // a - 880 Hz
+        1012, // b - 988 Hz
+        1912, // c - 523 Hz
+        1703, // d - 587 Hz
+        1517, // e - 659 Hz
+        1432, // f - 698 Hz
+        1275, // g - 784 Hz
+};
+
+static Song queue[SONG_QUEUE_LENGTH] MEM_AHB_BSS;
+static volatile int queueHead = 0; // Song being played
+static volatile int queueCount = 0;
+static volatile int curEvent = 0;
+static volatile int32_t remainingMs = 0;
+static volatile int isInGap = 0;
+static volatile int isPlaying = 0;
+static uint16_t tempo = SONG_DEFAULT_TEMPO;
+static int curVoice = SYNTH_NO_VOICE;
+
+// ########################################################################################
+// Get period of note
+// ########################################################################################
+static uint16_t getNote(uint8_t ch)
+{
+    if (ch >= 'A' && ch <= 'G')
+        return notes[ch - 'A'];
+
+    if (ch >= 'a' && ch <= 'g')
+        return notes[ch - 'a' + 7];
+
+    return 0;
+}
+
+// ########################################################################################
+// Get duration of note
+// ########################################################################################
+static uint16_t getDuration(uint8_t ch)
+{
+    if (ch < '0' || ch > '9')
+        return 400;
+
+    /* number of ms */
+
+    return (ch - '0') * 200;
+}
+
+// ########################################################################################
+// Get duration of pause
+// ########################################################################################
+static uint8_t getPause(uint8_t ch)
+{
+    switch (ch) {
+    case '+':
+        return 0;
+    case ',':
+        return 5;
+    case '.':
+        return 20;
+    case '_':
+        return 30;
+    default:
+        return 5;
+    }
+}
+
+// ########################################################################################
+// Starts a note, or silence if period is 0
+// ########################################################################################
+static void startTone(uint16_t period) {
+	synth_noteOff(curVoice);
+	curVoice = synth_noteOn(period, SYNTH_WAVE_SINE);
+}
+
+// ########################################################################################
+// Scales a duration by the tempo
+// ########################################################################################
+static int32_t scaleByTempo(uint32_t durationMs) {
+	return (durationMs*100)/tempo;
+}
+
+// ########################################################################################
+// Starts the current event of the song at the head of the queue
+// ########################################################################################
+static void startEvent() {
+	SongEvent *event = &queue[queueHead].events[curEvent];
+	startTone(event->period);
+	remainingMs = scaleByTempo(event->duration);
+	isInGap = 0;
+}
+
+// ########################################################################################
+// Sets up the synth that plays the notes
+// ########################################################################################
+void song_init() {
+	synth_init();
+	synth_setEnvelope(NOTE_ATTACK_TIME, NOTE_RELEASE_TIME);
+}
+
+// ########################################################################################
+// Compiles a song string such as "C2.C2,D4," into events. Returns number of events.
+// ########################################################################################
+int song_compile(uint8_t *str, Song *song) {
+    /*
+     * A song is a collection of tones where each tone is
+     * a note, duration and pause, e.g.
+     *
+     * "E2,F4,"
+     */
+	song->length = 0;
+	while (str[0] != '\0' && str[1] != '\0' && str[2] != '\0' && song->length < SONG_MAX_EVENTS) {
+		SongEvent *event = &song->events[song->length++];
+		event->period = getNote(str[0]);
+		event->duration = getDuration(str[1]);
+		event->gap = getPause(str[2]);
+		str += 3;
+	}
+	return song->length;
+}
+
+// ########################################################################################
+// Compiles a song into the queue. Returns 0 if the queue is full or the song is empty.
+// ########################################################################################
+int song_queue(uint8_t *str, int isLooping) {
+	Song *song;
+	if (queueCount >= SONG_QUEUE_LENGTH)
+		return 0;
+
+	song = &queue[(queueHead+queueCount)%SONG_QUEUE_LENGTH];
+	if (song_compile(str, song) == 0)
+		return 0;
+	song->isLooping = isLooping;
+
+	__disable_irq();
+	queueCount++;
+	if (!isPlaying) {
+		curEvent = 0;
+		isPlaying = 1;
+		startEvent();
+	}
+	__enable_irq();
+	return 1;
+}
+
+// ########################################################################################
+// Sets the speed of songs in percent, kept within SONG_MIN_TEMPO to SONG_MAX_TEMPO.
+// Takes effect from the next note.
+// ########################################################################################
+void song_setTempo(int percent) {
+	if (percent < SONG_MIN_TEMPO)
+		percent = SONG_MIN_TEMPO;
+	else if (percent > SONG_MAX_TEMPO)
+		percent = SONG_MAX_TEMPO;
+	tempo = percent;
+}
+
+// ########################################################################################
+// Stops playing and empties the queue
+// ########################################################################################
+void song_stop() {
+	__disable_irq();
+	isPlaying = 0;
+	queueCount = 0;
+	startTone(0);
+	__enable_irq();
+}
+
+// ########################################################################################
+// Advances the sequencer; run from the scheduler
+// ########################################################################################
+void song_tick(uint32_t elapsedMs) {
+	Song *song;
+
+	if (!isPlaying)
+		return;
+
+	remainingMs -= elapsedMs;
+	if (remainingMs > 0)
+		return;
+
+	song = &queue[queueHead];
+	if (!isInGap && song->events[curEvent].gap > 0) {
+		// Note is over, be silent for the gap
+		startTone(0);
+		remainingMs += scaleByTempo(song->events[curEvent].gap);
+		isInGap = 1;
+		return;
+	}
+
+	// Go to next event
+	curEvent++;
+	if (curEvent >= song->length) {
+		curEvent = 0;
+		// Looping songs repeat until another song is queued
+		if (!song->isLooping || queueCount > 1) {
+			queueHead = (queueHead+1)%SONG_QUEUE_LENGTH;
+			queueCount--;
+			if (queueCount == 0) {
+				isPlaying = 0;
+				startTone(0);
+				return;
+			}
+		}
+	}
+	startEvent();
+}
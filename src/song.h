@@ -0,0 +1,47 @@
+/*****************************************************************************
+ * Song header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef SONG_H_
+#define SONG_H_
+
+#include <stdint.h>
+
+#define SONG_MAX_EVENTS 64
+#define SONG_QUEUE_LENGTH 4
+#define SONG_DEFAULT_TEMPO 100 // Percent of normal speed
+#define SONG_MIN_TEMPO 25
+#define SONG_MAX_TEMPO 400 // Faster and short notes round to no ticks
+
+typedef struct SongEvent
+{
+	uint16_t period; // Period of note in us, 0 for a rest
+	uint16_t duration; // ms
+	uint8_t gap; // ms of silence after the note
+} SongEvent;
+
+typedef struct Song
+{
+	SongEvent events[SONG_MAX_EVENTS];
+	uint8_t length;
+	uint8_t isLooping;
+} Song;
+
+void song_init();
+
+int song_compile(uint8_t *str, Song *song);
+
+int song_queue(uint8_t *str, int isLooping);
+
+void song_setTempo(int percent);
+
+void song_stop();
+
+void song_tick(uint32_t elapsedMs);
+
+#endif /* SONG_H_ */
@@ -0,0 +1,383 @@
+/*****************************************************************************
+ * Synth functions
+ *
+ * Plays notes on the speaker through the DAC (AOUT on P0.26). The DAC is fed
+ * by GPDMA from a buffer of two blocks that the DMA channel loops over. When
+ * a block has been played, the DMA interrupt mixes the next block from up to
+ * SYNTH_VOICES oscillators, so audio costs the same small amount of CPU no
+ * matter how many notes are playing. Each voice has a linear attack/release
+ * envelope. Volume is set by stepping the LM4811 amplifier, whose pins are
+ * only driven while the synth is running, so the volume is set again from
+ * the bottom at every start.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "synth.h"
+#include "mem.h"
+#include "pinmux.h"
+
+#include "LPC17xx.h"
+#include "lpc17xx_pinsel.h"
+#include "lpc17xx_gpio.h"
+#include "lpc17xx_dac.h"
+#include "lpc17xx_gpdma.h"
+
+#define DMA_CHANNEL 0
+#define DAC_PCLK 25000000 // CCLK/4
+#define ENVELOPE_MAX 32767
+#define WAVETABLE_BITS 6 // 64 entries
+#define DAC_MIDPOINT 512
+#define LM4811_CLK (1<<27) // P0.27
+#define LM4811_UP_DN (1<<28) // P0.28
+#define LM4811_SHUTDN (1<<13) // P2.13
+
+// Voice states
+#define VOICE_OFF 0
+#define VOICE_ATTACK 1
+#define VOICE_SUSTAIN 2
+#define VOICE_RELEASE 3
+
+typedef struct Voice
+{
+	uint32_t phase;
+	uint32_t increment; // Added to phase every sample
+	int32_t envelope; // 0 to ENVELOPE_MAX
+	uint8_t state;
+	uint8_t waveform;
+} Voice;
+
+static const int16_t sineTable[1<<WAVETABLE_BITS] = {
+		0, 3212, 6393, 9512, 12539, 15446, 18204, 20787,
+		23170, 25329, 27245, 28898, 30273, 31356, 32137, 32609,
+		32767, 32609, 32137, 31356, 30273, 28898, 27245, 25329,
+		23170, 20787, 18204, 15446, 12539, 9512, 6393, 3212,
+		0, -3212, -6393, -9512, -12539, -15446, -18204, -20787,
+		-23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+		-32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+		-23170, -20787, -18204, -15446, -12539, -9512, -6393, -3212,
+};
+
+// The GPDMA can't reach RamLoc32, so the blocks and their LLIs live in RamAHB32
+static uint32_t samples[2][SYNTH_BLOCK_SIZE] MEM_AHB_BSS;
+static GPDMA_LLI_Type blockLLI[2] MEM_AHB_BSS;
+static Voice voices[SYNTH_VOICES];
+static int32_t attackStep = ENVELOPE_MAX; // Envelope change per block
+static int32_t releaseStep = ENVELOPE_MAX;
+static int nextBlock = 0; // Block to fill when the DMA finishes the current one
+static int isRunning = 0;
+static uint8_t volume = SYNTH_DEFAULT_VOLUME; // Set by synth_setVolume
+static uint8_t curVolume = 0; // Where the LM4811 is, known only while running
+
+// ########################################################################################
+// Returns sample of a waveform at phase, -32767 to 32767
+// ########################################################################################
+static int32_t getWaveSample(uint8_t waveform, uint32_t phase) {
+	int32_t ramp;
+	switch (waveform) {
+		case SYNTH_WAVE_SQUARE:
+			return (phase & 0x80000000) ? -ENVELOPE_MAX : ENVELOPE_MAX;
+		case SYNTH_WAVE_TRIANGLE:
+			ramp = phase >> 16; // 0 to 65535
+			return (ramp < 32768) ? ramp*2-32767 : 98303-ramp*2;
+		default:
+			return sineTable[phase >> (32-WAVETABLE_BITS)];
+	}
+}
+
+// ########################################################################################
+// Moves envelope of voice on by one block
+// ########################################################################################
+static void updateEnvelope(Voice *voice) {
+	switch (voice->state) {
+		case VOICE_ATTACK:
+			voice->envelope += attackStep;
+			if (voice->envelope >= ENVELOPE_MAX) {
+				voice->envelope = ENVELOPE_MAX;
+				voice->state = VOICE_SUSTAIN;
+			}
+			break;
+		case VOICE_RELEASE:
+			voice->envelope -= releaseStep;
+			if (voice->envelope <= 0) {
+				voice->envelope = 0;
+				voice->state = VOICE_OFF;
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+// ########################################################################################
+// Mixes all voices into a block of DAC values
+// ########################################################################################
+static void fillBlock(uint32_t *block) {
+	int i, v;
+	int32_t mix;
+	Voice *voice;
+
+	for (v=0;v<SYNTH_VOICES;v++) {
+		updateEnvelope(&voices[v]);
+	}
+
+	for (i=0;i<SYNTH_BLOCK_SIZE;i++) {
+		mix = 0;
+		for (v=0;v<SYNTH_VOICES;v++) {
+			voice = &voices[v];
+			if (voice->state != VOICE_OFF) {
+				mix += (getWaveSample(voice->waveform, voice->phase) * voice->envelope) >> 15;
+				voice->phase += voice->increment;
+			}
+		}
+		// Scale sum of voices to 10 bits around the midpoint
+		mix = DAC_MIDPOINT + mix/(SYNTH_VOICES*64);
+		if (mix < 0)
+			mix = 0;
+		if (mix > 1023)
+			mix = 1023;
+		block[i] = DAC_VALUE(mix);
+	}
+}
+
+// ########################################################################################
+// Sends one clock pulse to the LM4811 to step the volume up or down
+// ########################################################################################
+static void stepVolume(int isUp) {
+	if (isUp) {
+		GPIO_SetValue(0, LM4811_UP_DN);
+	} else {
+		GPIO_ClearValue(0, LM4811_UP_DN);
+	}
+	GPIO_SetValue(0, LM4811_CLK);
+	GPIO_ClearValue(0, LM4811_CLK);
+}
+
+// ########################################################################################
+// Steps the LM4811 to the volume asked for; its pins must be outputs
+// ########################################################################################
+static void applyVolume() {
+	while (curVolume < volume) {
+		stepVolume(1);
+		curVolume++;
+	}
+	while (curVolume > volume) {
+		stepVolume(0);
+		curVolume--;
+	}
+}
+
+// ########################################################################################
+// Drives the LM4811 pins, turns it on and sets the volume from the bottom
+// ########################################################################################
+static void startAmplifier() {
+	int i;
+
+	GPIO_SetDir(0, LM4811_CLK | LM4811_UP_DN, 1);
+	GPIO_SetDir(2, LM4811_SHUTDN, 1);
+	GPIO_ClearValue(0, LM4811_CLK | LM4811_UP_DN);
+	GPIO_ClearValue(2, LM4811_SHUTDN);
+
+	// Volume is unknown at power up or after the pins were let go
+	for (i=0;i<SYNTH_VOLUME_STEPS;i++) {
+		stepVolume(0);
+	}
+	curVolume = 0;
+	applyVolume();
+}
+
+// ########################################################################################
+// Silences both blocks and sets the DMA channel up from the first one
+// ########################################################################################
+static void setupChannel() {
+	GPDMA_Channel_CFG_Type dmaCfg;
+	int i;
+
+	for (i=0;i<SYNTH_BLOCK_SIZE;i++) {
+		samples[0][i] = samples[1][i] = DAC_VALUE(DAC_MIDPOINT);
+	}
+	nextBlock = 0;
+
+	dmaCfg.ChannelNum = DMA_CHANNEL;
+	dmaCfg.TransferSize = SYNTH_BLOCK_SIZE;
+	dmaCfg.TransferWidth = 0;
+	dmaCfg.SrcMemAddr = (uint32_t)samples[0];
+	dmaCfg.DstMemAddr = 0;
+	dmaCfg.TransferType = GPDMA_TRANSFERTYPE_M2P;
+	dmaCfg.SrcConn = 0;
+	dmaCfg.DstConn = GPDMA_CONN_DAC;
+	dmaCfg.DMALLI = (uint32_t)&blockLLI[1];
+	GPDMA_Setup(&dmaCfg);
+}
+
+// ########################################################################################
+// Sets up the DAC and the LLIs the DMA channel loops over
+// ########################################################################################
+void synth_init() {
+	DAC_CONVERTER_CFG_Type dacCfg;
+	int i;
+
+	DAC_Init(LPC_DAC);
+	DAC_SetDMATimeOut(LPC_DAC, DAC_PCLK/SYNTH_SAMPLE_RATE);
+	dacCfg.DBLBUF_ENA = 0;
+	dacCfg.CNT_ENA = 1;
+	dacCfg.DMA_ENA = 1;
+	DAC_ConfigDAConverterControl(LPC_DAC, &dacCfg);
+
+	// Each block links to the other so that the channel never stops
+	for (i=0;i<2;i++) {
+		blockLLI[i].SrcAddr = (uint32_t)samples[i];
+		blockLLI[i].DstAddr = (uint32_t)&LPC_DAC->DACR;
+		blockLLI[i].NextLLI = (uint32_t)&blockLLI[1-i];
+		blockLLI[i].Control = GPDMA_DMACCxControl_TransferSize(SYNTH_BLOCK_SIZE)
+				| GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_WORD)
+				| GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_WORD)
+				| GPDMA_DMACCxControl_SI
+				| GPDMA_DMACCxControl_I;
+	}
+
+	GPDMA_Init();
+
+	// Same level as EINT3 and above the TIMER0 scheduler, so blocks are refilled in time
+	uint32_t prio, PG = 5, PP=0b10, SP=0b000;
+	prio = NVIC_EncodePriority(PG, PP, SP);
+	NVIC_SetPriority(DMA_IRQn, prio);
+	NVIC_EnableIRQ(DMA_IRQn);
+}
+
+// ########################################################################################
+// Turns the amplifier on, connects the DAC to P0.26 and streams from the first block
+// ########################################################################################
+void synth_start() {
+	PINSEL_CFG_Type PinCfg;
+
+	// P0.26 is also the RGB blue LED
+	if (isRunning || !pinmux_claim(PINMUX_P0_26, PINMUX_OWNER_SPEAKER))
+		return;
+
+	// P0.26 - AOUT
+	PinCfg.Funcnum = 2;
+	PinCfg.OpenDrain = 0;
+	PinCfg.Pinmode = 0;
+	PinCfg.Portnum = 0;
+	PinCfg.Pinnum = 26;
+	PINSEL_ConfigPin(&PinCfg);
+
+	startAmplifier();
+	// The channel was stopped part way through a block, so start it again from scratch
+	setupChannel();
+	GPDMA_ChannelCmd(DMA_CHANNEL, ENABLE);
+	isRunning = 1;
+}
+
+// ########################################################################################
+// Stops streaming, gives P0.26 back to GPIO and lets go of the amplifier
+// ########################################################################################
+void synth_stop() {
+	PINSEL_CFG_Type PinCfg;
+
+	if (!isRunning)
+		return;
+
+	GPDMA_ChannelCmd(DMA_CHANNEL, DISABLE);
+	synth_allNotesOff();
+	isRunning = 0;
+
+	PinCfg.Funcnum = 0;
+	PinCfg.OpenDrain = 0;
+	PinCfg.Pinmode = 0;
+	PinCfg.Portnum = 0;
+	PinCfg.Pinnum = 26;
+	PINSEL_ConfigPin(&PinCfg);
+	pinmux_release(PINMUX_P0_26, PINMUX_OWNER_SPEAKER);
+
+	GPIO_SetDir(0, LM4811_CLK | LM4811_UP_DN, 0);
+	GPIO_SetDir(2, LM4811_SHUTDN, 0);
+}
+
+// ########################################################################################
+// Starts a note with the given period in us. Returns voice used, or SYNTH_NO_VOICE.
+// ########################################################################################
+int synth_noteOn(uint16_t period, uint8_t waveform) {
+	int v, quietest = 0;
+
+	if (period == 0)
+		return SYNTH_NO_VOICE;
+
+	// Use a free voice, otherwise take over the quietest one
+	for (v=0;v<SYNTH_VOICES;v++) {
+		if (voices[v].state == VOICE_OFF) {
+			quietest = v;
+			break;
+		}
+		if (voices[v].envelope < voices[quietest].envelope)
+			quietest = v;
+	}
+
+	__disable_irq();
+	voices[quietest].phase = 0;
+	// Frequency is 1000000/period, phase wraps at 2^32 once per cycle
+	voices[quietest].increment = (uint32_t)((((uint64_t)1000000) << 32) / ((uint64_t)period*SYNTH_SAMPLE_RATE));
+	voices[quietest].envelope = 0;
+	voices[quietest].waveform = waveform;
+	voices[quietest].state = VOICE_ATTACK;
+	__enable_irq();
+	return quietest;
+}
+
+// ########################################################################################
+// Lets a note fade out
+// ########################################################################################
+void synth_noteOff(int voice) {
+	if (voice >= 0 && voice < SYNTH_VOICES && voices[voice].state != VOICE_OFF)
+		voices[voice].state = VOICE_RELEASE;
+}
+
+// ########################################################################################
+// Silences every voice at once
+// ########################################################################################
+void synth_allNotesOff() {
+	int v;
+	for (v=0;v<SYNTH_VOICES;v++) {
+		voices[v].state = VOICE_OFF;
+		voices[v].envelope = 0;
+	}
+}
+
+// ########################################################################################
+// Sets attack and release time of notes
+// ########################################################################################
+void synth_setEnvelope(uint16_t attackMs, uint16_t releaseMs) {
+	// Envelope moves once per block
+	uint32_t blocksPerSecond = SYNTH_SAMPLE_RATE/SYNTH_BLOCK_SIZE;
+	uint32_t attackBlocks = (attackMs*blocksPerSecond)/1000;
+	uint32_t releaseBlocks = (releaseMs*blocksPerSecond)/1000;
+	attackStep = ENVELOPE_MAX/(attackBlocks > 0 ? attackBlocks : 1);
+	releaseStep = ENVELOPE_MAX/(releaseBlocks > 0 ? releaseBlocks : 1);
+}
+
+// ########################################################################################
+// Sets speaker volume from 0 to SYNTH_VOLUME_STEPS-1, now if running or else at the next start
+// ########################################################################################
+void synth_setVolume(uint8_t newVolume) {
+	volume = (newVolume >= SYNTH_VOLUME_STEPS) ? SYNTH_VOLUME_STEPS-1 : newVolume;
+	if (isRunning)
+		applyVolume();
+}
+
+// ########################################################################################
+// Interrupt: DMA interrupt handler - refills the block that has just been played
+// ########################################################################################
+void DMA_IRQHandler(void) {
+	if (GPDMA_IntGetStatus(GPDMA_STAT_INTTC, DMA_CHANNEL)) {
+		GPDMA_ClearIntPending(GPDMA_STATCLR_INTTC, DMA_CHANNEL);
+		fillBlock(samples[nextBlock]);
+		nextBlock = 1-nextBlock;
+	}
+	if (GPDMA_IntGetStatus(GPDMA_STAT_INTERR, DMA_CHANNEL)) {
+		GPDMA_ClearIntPending(GPDMA_STATCLR_INTERR, DMA_CHANNEL);
+	}
+}
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ * Synth header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include <stdint.h>
+
+#define SYNTH_SAMPLE_RATE 16000
+#define SYNTH_BLOCK_SIZE 128 // Samples in each half of the DMA buffer
+#define SYNTH_VOICES 4
+#define SYNTH_VOLUME_STEPS 16 // LM4811 volume steps
+#define SYNTH_DEFAULT_VOLUME 8
+#define SYNTH_NO_VOICE -1
+
+// Waveforms
+#define SYNTH_WAVE_SINE 0
+#define SYNTH_WAVE_SQUARE 1
+#define SYNTH_WAVE_TRIANGLE 2
+
+void synth_init();
+
+void synth_start();
+
+void synth_stop();
+
+int synth_noteOn(uint16_t period, uint8_t waveform);
+
+void synth_noteOff(int voice);
+
+void synth_allNotesOff();
+
+void synth_setEnvelope(uint16_t attackMs, uint16_t releaseMs);
+
+void synth_setVolume(uint8_t newVolume);
+
+#endif /* SYNTH_H_ */
@@ -1,6 +1,11 @@
 /*****************************************************************************
  * Task functions
  *
+ * Lists and the task pool are changed from the main loop and from interrupts
+ * (TIMER0 runs the fast list, EINT3 adds tasks to it), so adding, removing
+ * and taking a pool slot run with interrupts off. Each only goes over a
+ * handful of entries. The host tests have no interrupts to hold off.
+ *
  * Author: Chang Chu-Ming
  *         Terry Chua
  *
@@ -8,33 +13,120 @@
  *
  ******************************************************************************/
 #include "task.h"
-#include <math.h>
-#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __arm__
+#include "LPC17xx.h"
+
+// Keeps interrupts off if the caller had already turned them off
+#define LOCK(saved) do { (saved) = __get_PRIMASK(); __disable_irq(); } while (0)
+#define UNLOCK(saved) __set_PRIMASK(saved)
+#else
+#define LOCK(saved) ((saved) = 0)
+#define UNLOCK(saved) ((void)(saved))
+#endif
+
+static int tickMillis = TASK_TICK_MILLIS; // Set by setTaskTick
+static uint16_t tickGeneration = 0; // Changes with the tick or any interval; TASK_INIT tasks start at 0
+static uint32_t (*getTime)() = NULL; // Set by setTaskClock; stamps lastRun for the watchdog
+static Task taskPool[TASK_POOL_SIZE]; // Slots with no function are free
+
+// ########################################################################################
+// Returns how many ticks of tickIntervalConstant ms make up interval
+// ########################################################################################
+static uint16_t ticksFor(int interval, int tickIntervalConstant) {
+	int ticks = interval/tickIntervalConstant;
+	if (ticks < 0)
+		return 0; // Already late, so run on the next tick
+	return (ticks > TASK_MAX_TICKS) ? TASK_MAX_TICKS : ticks;
+}
+
+// ########################################################################################
+// Returns a task's ticksBeforeRun, worked out again if the tick changed since
+// ########################################################################################
+static uint16_t currentTicks(Task *task) {
+	if (task->tickGeneration != tickGeneration) {
+		task->ticksBeforeRun = ticksFor(task->interval, tickMillis);
+		task->tickGeneration = tickGeneration;
+	}
+	return task->ticksBeforeRun;
+}
 
 // ########################################################################################
-// Returns a new task as a pointer
+// Returns a new task as a pointer, or NULL if the pool is used up
 // ########################################################################################
 Task *newTask(void (*givenTask)(), int interval, int repeatCount, int tickIntervalConstant) {
-	Task *task;
-	if((task = malloc(sizeof *task)) != NULL)
+	Task *task = NULL;
+	int slot;
+	uint32_t saved;
+
+	LOCK(saved);
+	for (slot=0;slot<TASK_POOL_SIZE;slot++) {
+		if (taskPool[slot].task == NULL) {
+			task = &taskPool[slot];
+			task->task = givenTask; // Taken before anyone else can look
+			break;
+		}
+	}
+	UNLOCK(saved);
+	if(task != NULL)
 	  {
-		task->task = givenTask;
 		task->interval = interval;
 		task->repeatCount = repeatCount;
 		task->runCount = 0;
-		task->ticksBeforeRun = ceil(task->interval/tickIntervalConstant);
-		task->tickCount = 0;
+		task->ticksBeforeRun = ticksFor(task->interval, tickIntervalConstant);
+		task->tickGeneration = tickGeneration;
+		task->isScheduled = 0;
+		task->lastRun = 0;
+		task->isTemporary = 0;
 	  }
 	  return task;
 }
 
+// ########################################################################################
+// Changes how often a task runs, starting from its next run
+// ########################################################################################
+void setTaskInterval(Task *task, int interval, int tickIntervalConstant) {
+	task->interval = interval;
+	task->ticksBeforeRun = ticksFor(task->interval, tickIntervalConstant);
+	// Lists copy ticksBeforeRun again before their next tick
+	task->tickGeneration = ++tickGeneration;
+}
+
+// ########################################################################################
+// Changes the tick length. Tasks work out their ticks again before their next tick.
+// ########################################################################################
+void setTaskTick(int tickIntervalConstant) {
+	tickMillis = tickIntervalConstant;
+	tickGeneration++;
+}
+
+// ########################################################################################
+// Sets the clock used to time task runs
+// ########################################################################################
+void setTaskClock(uint32_t (*getTicks)()) {
+	getTime = getTicks;
+}
+
+// ########################################################################################
+// Returns the time on the task clock, 0 if there is none
+// ########################################################################################
+uint32_t getTaskTime() {
+	return (getTime != NULL) ? getTime() : 0;
+}
+
 // ########################################################################################
 // Runs a given task once
 // ########################################################################################
 void runTaskOnce(Task *task) {
 	if (task->runCount<task->repeatCount || task->repeatCount==-1) {
 //		printf("run: %i %i \n", task->runCount, task->repeatCount);
-		task->runCount++;
+		// Endless tasks are not counted, so runCount cannot wrap and stopping them
+		// with repeatCount 0 always works
+		if (task->repeatCount != -1)
+			task->runCount++;
+		if (getTime != NULL)
+			task->lastRun = getTime();
 		task->task();
 	}
 }
@@ -42,48 +134,86 @@ void runTaskOnce(Task *task) {
 // ########################################################################################
 // Check all tasks in task list and run if necessary
 // ########################################################################################
-void checkAndRunTasks(Task *taskList[10], int *taskCount) {
+void checkAndRunTasks(TaskList *taskList) {
 	int taskNum;
-	for (taskNum=0;taskNum<*taskCount;taskNum++) {
-		taskList[taskNum]->tickCount++;
-		if (taskList[taskNum]->tickCount >= taskList[taskNum]->ticksBeforeRun) {
-			taskList[taskNum]->tickCount = 0;
-			runTaskOnce(taskList[taskNum]);
+
+	if (taskList->tickGeneration != tickGeneration) {
+		taskList->tickGeneration = tickGeneration;
+		for (taskNum=0;taskNum<taskList->count;taskNum++)
+			taskList->ticksBeforeRun[taskNum] = currentTicks(taskList->task[taskNum]);
+	}
+	// Only the counters are read until a task is due
+	for (taskNum=0;taskNum<taskList->count;taskNum++) {
+		if (++taskList->tickCount[taskNum] >= taskList->ticksBeforeRun[taskNum]) {
+			taskList->tickCount[taskNum] = 0;
+			runTaskOnce(taskList->task[taskNum]);
 		}
 	}
 }
 
 // ########################################################################################
-// Add task to task list
+// Add task to task list. Returns 0 if the list is full.
 // ########################################################################################
-void addTask(Task *taskList[10], int *taskCount, Task *task) {
-	taskList[*taskCount] = task;
-//	printf("t1: %d\n", *taskCount);
-	*taskCount = *taskCount+1;
-//	printf("t2: %d\n", *taskCount);
+int addTask(TaskList *taskList, Task *task) {
+	int taskNum;
+	uint32_t saved;
+
+	LOCK(saved);
+	// Stopped and started again before removeFinishedTasks took it off, so it keeps its
+	// slot and starts its interval again instead of being on the list twice
+	if (task->isScheduled) {
+		for (taskNum=0;taskNum<taskList->count;taskNum++) {
+			if (taskList->task[taskNum] == task) {
+				taskList->tickCount[taskNum] = 0;
+				taskList->ticksBeforeRun[taskNum] = currentTicks(task);
+			}
+		}
+		if (getTime != NULL)
+			task->lastRun = getTime();
+		UNLOCK(saved);
+		return 1;
+	}
+	taskNum = taskList->count;
+	if (taskNum >= TASK_LIST_SIZE) {
+		UNLOCK(saved);
+		return 0;
+	}
+	if (getTime != NULL)
+		task->lastRun = getTime();
+	task->isScheduled = 1;
+	taskList->task[taskNum] = task;
+	taskList->tickCount[taskNum] = 0;
+	taskList->ticksBeforeRun[taskNum] = currentTicks(task);
+	taskList->count = taskNum+1;
+	UNLOCK(saved);
+	return 1;
 }
 
 // ########################################################################################
-// Remove task from task list
-// ########################################################################################
-void removeFinishedTasks(Task *taskList[10], int *taskCount) {
-	int taskNum = 0;
-////	printf("At start %d %d\n", taskNum, *taskCount);
-////	printf("%d %d\n", taskNum, *taskCount);
-//	while (taskNum<*taskCount) {
-		for (taskNum=0;taskNum<*taskCount;taskNum++) {
-			if (taskList[taskNum]->runCount >= taskList[taskNum]->repeatCount && taskList[taskNum]->repeatCount!=-1) {
-//				printf("remove: %d %i %i \n", taskNum, taskList[taskNum]->runCount, taskList[taskNum]->repeatCount);
-				int oldTaskNum;
-				for (oldTaskNum=taskNum;oldTaskNum<*taskCount-1;oldTaskNum++) {
-					taskList[oldTaskNum] = taskList[oldTaskNum+1];
-				}
-//				taskList[oldTaskNum] = '\0';
-				*taskCount = *taskCount-1;
-//				printf("After remove %d%d %d %d\n", taskList[0]->runCount, taskList[0]->repeatCount, taskNum, *taskCount);
-				taskNum = 0;
-				break;
-			}
+// Remove finished tasks from task list
+// ########################################################################################
+void removeFinishedTasks(TaskList *taskList) {
+	int taskNum, keptNum = 0;
+	Task *task;
+	uint32_t saved;
+
+	// An addTask from an interrupt part way through would land past the new count
+	LOCK(saved);
+	for (taskNum=0;taskNum<taskList->count;taskNum++) {
+		task = taskList->task[taskNum];
+		if (task->runCount >= task->repeatCount && task->repeatCount != -1) {
+			task->isScheduled = 0;
+			if (task->isTemporary)
+				task->task = NULL; // Back to the pool
+			continue;
 		}
-//	}
+		if (keptNum != taskNum) {
+			taskList->task[keptNum] = task;
+			taskList->tickCount[keptNum] = taskList->tickCount[taskNum];
+			taskList->ticksBeforeRun[keptNum] = taskList->ticksBeforeRun[taskNum];
+		}
+		keptNum++;
+	}
+	taskList->count = keptNum;
+	UNLOCK(saved);
 }
@@ -7,25 +7,101 @@
  * Date: 25/10/2015
  *
  ******************************************************************************/
+#ifndef TASK_H_
+#define TASK_H_
+
+#include <stdint.h>
+
+#define TASK_POOL_SIZE 12 // Tasks newTask can hand out at once; it returns NULL past this
+#define TASK_TICK_MILLIS 5 // Tick length until setTaskTick, which TASK_INIT works out ticks for
+#define TASK_MAX_TICKS 0xFFFF
+#define TASK_LIST_SIZE 24 // Tasks one list can hold; addTask refuses more
+
 typedef struct Task
 {
 	// Parameter
 	void (*task)();
-	int interval;
-	int repeatCount; // Set to -1 for infinite repeats, 0 for zero repeats
+	int32_t interval;
+	int16_t repeatCount; // Set to -1 for infinite repeats, 0 for zero repeats
 
 	// To be initialized
-	int runCount;
-	int ticksBeforeRun;
-	int tickCount;
+	int16_t runCount; // Runs so far, counted only while repeatCount is not -1
+	uint32_t lastRun; // Time of the last run, or of being added to a list
+	uint16_t ticksBeforeRun; // Copied into a TaskList when the task is added
+	uint16_t tickGeneration; // Tick length and interval ticksBeforeRun was worked out for
+	uint8_t isScheduled; // On a task list
+	uint8_t isTemporary; // Given back to the pool when it finishes and leaves its list
 } Task;
 
+// Initializer for a Task that always exists, so it is filled in by the compiler
+// instead of newTask. interval must be a constant.
+#define TASK_INIT(function, interval, repeatCount) \
+	{ (function), (interval), (repeatCount), 0, 0, \
+	  ((interval)/TASK_TICK_MILLIS > TASK_MAX_TICKS) ? TASK_MAX_TICKS : (interval)/TASK_TICK_MILLIS, \
+	  0, 0, 0 }
+
+// Tasks waiting to run. The counters checked every tick are kept in their own
+// arrays, next to each other, so a tick only reads the Tasks that are due.
+typedef struct TaskList
+{
+	uint16_t tickCount[TASK_LIST_SIZE];
+	uint16_t ticksBeforeRun[TASK_LIST_SIZE];
+	Task *task[TASK_LIST_SIZE];
+	uint16_t tickGeneration; // Tick length and intervals ticksBeforeRun was copied for
+	uint8_t count;
+} TaskList;
+
+// Coroutine: a task function written as straight line code that gives the CPU back at
+// each COROUTINE_AWAIT and carries on from there the next time it runs, protothread
+// style. Locals do not keep their values across an await; use statics. Give coroutine
+// tasks COROUTINE_INTERVAL so they can check their awaits every tick.
+typedef struct Coroutine
+{
+	uint16_t resume; // Line to carry on from, 0 to start from the top
+	uint32_t wakeTime; // Task clock time COROUTINE_AWAIT_MS ends at
+} Coroutine;
+
+#define COROUTINE_INTERVAL 0 // Every tick, whatever its length
+
+#define COROUTINE_BEGIN(co) switch ((co)->resume) { case 0:
+
+// Returns from the task until condition holds, then carries on from here
+#define COROUTINE_AWAIT_UNTIL(co, condition) \
+	do { \
+		(co)->resume = __LINE__; case __LINE__: \
+		if (!(condition)) \
+			return; \
+	} while (0)
+
+// Returns from the task until ms have passed on the task clock
+#define COROUTINE_AWAIT_MS(co, ms) \
+	do { \
+		(co)->wakeTime = getTaskTime() + (ms); \
+		COROUTINE_AWAIT_UNTIL(co, (int32_t)(getTaskTime() - (co)->wakeTime) >= 0); \
+	} while (0)
+
+// Ends the coroutine and takes its task off its list
+#define COROUTINE_END(co, task) } (co)->resume = 0; (task)->repeatCount = 0
+
+// Makes the coroutine start from the top the next time it runs
+#define COROUTINE_RESTART(co) ((co)->resume = 0)
+
 Task *newTask(void (*givenTask)(), int interval, int repeatCount, int tickIntervalConstant);
 
+void setTaskInterval(Task *task, int interval, int tickIntervalConstant);
+
+void setTaskTick(int tickIntervalConstant);
+
+void setTaskClock(uint32_t (*getTicks)());
+
+uint32_t getTaskTime();
+
 void runTaskOnce(Task *task);
 
-void checkAndRunTasks(Task *taskList[10], int *taskCount);
+void checkAndRunTasks(TaskList *taskList);
+
+int addTask(TaskList *taskList, Task *task);
 
-void addTask(Task *taskList2[10], int *taskCount2, Task *task);
+void removeFinishedTasks(TaskList *taskList);
 
-void removeFinishedTasks(Task *taskList[10], int *taskCount);
+#endif /* TASK_H_ */
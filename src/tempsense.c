@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * Temperature sensor functions
+ *
+ * The MAX6576 outputs a square wave on P0.2 whose period is 10 us per kelvin.
+ * Instead of polling the pin against the 1 ms tick, rising edges interrupt
+ * through EINT3 and are timestamped with TIMER2 running freely at 1 us. After
+ * TEMPSENSE_PERIODS periods the edge interrupt is turned off again and the
+ * average is kept, so reading the temperature never waits on the sensor.
+ * The median of the last TEMPSENSE_MEDIAN averages is what is read, which
+ * throws away a single reading spoilt by a late edge interrupt.
+ *
+ * P0.2 is not a timer capture input on the LPC1768, so the timestamp is taken
+ * from the counter in the edge interrupt rather than latched by hardware.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "tempsense.h"
+#include "fixed.h"
+
+#include "LPC17xx.h"
+#include "lpc17xx_timer.h"
+
+#define TEMP_PIN (1<<2) // P0.2
+#define KELVIN_OFFSET 2731 // 0 C in tenths of a kelvin
+
+static volatile int32_t lastReading = TEMPSENSE_INVALID;
+static volatile int edgeCount = 0;
+static volatile uint32_t firstEdge = 0;
+static volatile int isMeasuring = 0;
+static int32_t history[TEMPSENSE_MEDIAN]; // Last averages, in any order
+static int historyCount = 0;
+static int historyNext = 0;
+static volatile int32_t offset = 0; // Calibration, in tenths of a degree C
+
+// ########################################################################################
+// Starts TIMER2 counting microseconds and sets up the P0.2 edge interrupt
+// ########################################################################################
+void tempsense_init() {
+	TIM_TIMERCFG_Type TIM_ConfigStruct;
+
+	// Free running, wraps after 71 minutes which unsigned subtraction handles
+	TIM_ConfigStruct.PrescaleOption = TIM_PRESCALE_USVAL;
+	TIM_ConfigStruct.PrescaleValue = 1;
+	TIM_Init(LPC_TIM2, TIM_TIMER_MODE, &TIM_ConfigStruct);
+	TIM_Cmd(LPC_TIM2, ENABLE);
+
+	LPC_GPIOINT->IO0IntEnR &= ~TEMP_PIN;
+	LPC_GPIOINT->IO0IntClr = TEMP_PIN;
+	NVIC_EnableIRQ(EINT3_IRQn);
+
+	tempsense_start();
+}
+
+// ########################################################################################
+// Starts measuring a new reading in the background; run every TEMPSENSE_INTERVAL
+// ########################################################################################
+void tempsense_start() {
+	if (isMeasuring)
+		return;
+	edgeCount = 0;
+	isMeasuring = 1;
+	LPC_GPIOINT->IO0IntClr = TEMP_PIN;
+	LPC_GPIOINT->IO0IntEnR |= TEMP_PIN;
+}
+
+// ########################################################################################
+// Interrupt: rising edge on P0.2, called from EINT3_IRQHandler
+// ########################################################################################
+void tempsense_edgeHandler() {
+	uint32_t now = LPC_TIM2->TC;
+
+	LPC_GPIOINT->IO0IntClr = TEMP_PIN;
+	if (edgeCount == 0) {
+		firstEdge = now;
+	} else if (edgeCount == TEMPSENSE_PERIODS) {
+		// Period in us is tenths of a kelvin
+		history[historyNext] = fixed_divRound(now-firstEdge, TEMPSENSE_PERIODS) - KELVIN_OFFSET;
+		historyNext = (historyNext+1) % TEMPSENSE_MEDIAN;
+		if (historyCount < TEMPSENSE_MEDIAN)
+			historyCount++;
+		lastReading = fixed_median(history, historyCount);
+		LPC_GPIOINT->IO0IntEnR &= ~TEMP_PIN;
+		isMeasuring = 0;
+		return;
+	}
+	edgeCount++;
+}
+
+// ########################################################################################
+// Returns the last temperature in tenths of a degree C, TEMPSENSE_INVALID before the first
+// ########################################################################################
+int32_t tempsense_read() {
+	int32_t reading = lastReading;
+
+	return (reading == TEMPSENSE_INVALID) ? TEMPSENSE_INVALID : reading + offset;
+}
+
+// ########################################################################################
+// Sets the calibration offset in tenths of a degree C added to every reading
+// ########################################################################################
+void tempsense_setOffset(int32_t tenths) {
+	offset = tenths;
+}
@@ -0,0 +1,30 @@
+/*****************************************************************************
+ * Temperature sensor header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef TEMPSENSE_H_
+#define TEMPSENSE_H_
+
+#include <stdint.h>
+
+#define TEMPSENSE_PERIODS 64 // Periods averaged for one reading
+#define TEMPSENSE_MEDIAN 3 // Averages a reading is the median of, at most FIXED_MEDIAN_MAX
+#define TEMPSENSE_INTERVAL 500 // A new reading is started every TEMPSENSE_INTERVAL ms
+#define TEMPSENSE_INVALID (-32768)
+
+void tempsense_init();
+
+void tempsense_start();
+
+void tempsense_edgeHandler();
+
+int32_t tempsense_read();
+
+void tempsense_setOffset(int32_t tenths);
+
+#endif /* TEMPSENSE_H_ */
@@ -0,0 +1,208 @@
+/*****************************************************************************
+ * Terminal functions
+ *
+ * Builds VT100 output for the home terminal in one buffer and keeps track of
+ * where the remote cursor is, so that cursor moves are only sent when a
+ * character is actually drawn and always use the shortest escape sequence.
+ *
+ * The buffer and cursor are not protected against interrupts, so only the
+ * main loop (and the slow tasks it runs) may write to the terminal. The
+ * UART interrupt queues keystrokes for the main loop instead of answering.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "terminal.h"
+#include "mem.h"
+#include <string.h>
+
+#include "lpc17xx_uart.h"
+
+#define ESC 27
+#define MAX_MOVE_LENGTH 10 // ESC[rr;ccH
+
+static uint8_t buffer[TERM_BUFFER_SIZE] MEM_AHB_BSS;
+static int bufferLength = 0;
+static uint8_t curCol = TERM_POS_UNKNOWN; // Where the remote cursor is
+static uint8_t curRow = TERM_POS_UNKNOWN;
+static uint8_t wantCol = TERM_POS_UNKNOWN; // Where the next character should go
+static uint8_t wantRow = TERM_POS_UNKNOWN;
+
+// ########################################################################################
+// Returns number of decimal digits in value
+// ########################################################################################
+static int countDigits(uint8_t value) {
+	if (value >= 100)
+		return 3;
+	if (value >= 10)
+		return 2;
+	return 1;
+}
+
+// ########################################################################################
+// Appends a decimal number to the buffer
+// ########################################################################################
+static void appendNumber(uint8_t value) {
+	if (value >= 100)
+		buffer[bufferLength++] = '0' + value/100;
+	if (value >= 10)
+		buffer[bufferLength++] = '0' + (value/10)%10;
+	buffer[bufferLength++] = '0' + value%10;
+}
+
+// ########################################################################################
+// Appends ESC[nX, leaving out n when it is 1
+// ########################################################################################
+static void appendRelative(uint8_t count, uint8_t command) {
+	buffer[bufferLength++] = ESC;
+	buffer[bufferLength++] = '[';
+	if (count != 1)
+		appendNumber(count);
+	buffer[bufferLength++] = command;
+}
+
+// ########################################################################################
+// Returns length of ESC[nX
+// ########################################################################################
+static int relativeLength(uint8_t count) {
+	return (count == 1) ? 3 : 3+countDigits(count);
+}
+
+// ########################################################################################
+// Sends everything in the buffer in a single UART_Send
+// ########################################################################################
+static void sendBuffer() {
+	if (bufferLength > 0) {
+		UART_Send(LPC_UART3, buffer, bufferLength, BLOCKING);
+		bufferLength = 0;
+	}
+}
+
+// ########################################################################################
+// Sends the cheapest sequence that takes the remote cursor to the wanted position
+// ########################################################################################
+static void emitMove() {
+	int absLength, relLength, colLength;
+	int dx = 0, dy = 0;
+
+	if (wantCol == TERM_POS_UNKNOWN || (wantCol == curCol && wantRow == curRow))
+		return;
+
+	if (bufferLength+MAX_MOVE_LENGTH > TERM_BUFFER_SIZE)
+		sendBuffer();
+
+	// ESC[H homes the cursor, otherwise ESC[row;colH
+	absLength = (wantCol == 1 && wantRow == 1) ? 3 : 4+countDigits(wantRow)+countDigits(wantCol);
+
+	if (curCol == TERM_POS_UNKNOWN) {
+		relLength = absLength+1; // Relative moves need a known position
+	} else {
+		dx = wantCol-curCol;
+		dy = wantRow-curRow;
+		relLength = (dy != 0) ? relativeLength(dy > 0 ? dy : -dy) : 0;
+		if (dx > 0) {
+			colLength = relativeLength(dx);
+		} else if (dx < 0 && wantCol == 1) {
+			colLength = 1; // Carriage return
+		} else if (dx < 0 && dx >= -2) {
+			colLength = -dx; // Backspaces
+		} else if (dx < 0) {
+			colLength = relativeLength(-dx);
+		} else {
+			colLength = 0;
+		}
+		relLength += colLength;
+	}
+
+	if (absLength <= relLength) {
+		buffer[bufferLength++] = ESC;
+		buffer[bufferLength++] = '[';
+		if (wantCol != 1 || wantRow != 1) {
+			appendNumber(wantRow);
+			buffer[bufferLength++] = ';';
+			appendNumber(wantCol);
+		}
+		buffer[bufferLength++] = 'H';
+	} else {
+		if (dy < 0)
+			appendRelative(-dy, 'A');
+		else if (dy > 0)
+			appendRelative(dy, 'B');
+
+		if (dx > 0) {
+			appendRelative(dx, 'C');
+		} else if (dx < 0 && wantCol == 1) {
+			buffer[bufferLength++] = '\r';
+		} else if (dx < 0 && dx >= -2) {
+			while (dx++ < 0)
+				buffer[bufferLength++] = '\b';
+		} else if (dx < 0) {
+			appendRelative(-dx, 'D');
+		}
+	}
+
+	curCol = wantCol;
+	curRow = wantRow;
+}
+
+// ########################################################################################
+// Sets the position of the next character. Nothing is sent until it is needed.
+// ########################################################################################
+void term_moveTo(uint8_t col, uint8_t row) {
+	wantCol = col;
+	wantRow = row;
+}
+
+// ########################################################################################
+// Draws a character at the wanted position
+// ########################################################################################
+void term_putChar(uint8_t ch) {
+	emitMove();
+	if (bufferLength+1 > TERM_BUFFER_SIZE)
+		sendBuffer();
+	buffer[bufferLength++] = ch;
+	// Cursor moves right after a character is drawn
+	if (curCol != TERM_POS_UNKNOWN) {
+		curCol++;
+		wantCol = curCol;
+		wantRow = curRow;
+	}
+}
+
+// ########################################################################################
+// Sends a block of text. Position of the cursor is unknown afterwards.
+// ########################################################################################
+void term_write(char *str) {
+	sendBuffer();
+	UART_Send(LPC_UART3, (uint8_t *)str, strlen(str), BLOCKING);
+	curCol = curRow = TERM_POS_UNKNOWN;
+	wantCol = wantRow = TERM_POS_UNKNOWN;
+}
+
+// ########################################################################################
+// Clears the screen and homes the cursor
+// ########################################################################################
+void term_clear() {
+	if (bufferLength+7 > TERM_BUFFER_SIZE)
+		sendBuffer();
+	buffer[bufferLength++] = ESC;
+	buffer[bufferLength++] = '[';
+	buffer[bufferLength++] = '2';
+	buffer[bufferLength++] = 'J';
+	buffer[bufferLength++] = ESC;
+	buffer[bufferLength++] = '[';
+	buffer[bufferLength++] = 'H';
+	curCol = curRow = 1;
+	wantCol = wantRow = 1;
+}
+
+// ########################################################################################
+// Sends pending cursor move together with everything in the buffer
+// ########################################################################################
+void term_flush() {
+	emitMove();
+	sendBuffer();
+}
@@ -0,0 +1,28 @@
+/*****************************************************************************
+ * Terminal header file
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef TERMINAL_H_
+#define TERMINAL_H_
+
+#include <stdint.h>
+
+#define TERM_BUFFER_SIZE 64
+#define TERM_POS_UNKNOWN 0 // Terminal rows and columns start at 1
+
+void term_moveTo(uint8_t col, uint8_t row);
+
+void term_putChar(uint8_t ch);
+
+void term_write(char *str);
+
+void term_clear();
+
+void term_flush();
+
+#endif /* TERMINAL_H_ */
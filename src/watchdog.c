@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * Watchdog supervisor functions
+ *
+ * watchdog_check runs from SysTick. While a watched task is on a list, its
+ * last run (stamped by the scheduler) must be within its deadline. If one is
+ * late, its number goes into a crash dump and the chip resets at once. If
+ * SysTick itself is stuck behind a hung interrupt, the WDT stops being fed
+ * and resets the chip after WATCHDOG_TIMEOUT, without a name.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "watchdog.h"
+#include "crash.h"
+#include <stddef.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_wdt.h"
+
+#define RSID_WDTR (1<<2)
+
+typedef struct Watch
+{
+	Task *task;
+	const char *name;
+	uint32_t deadline;
+} Watch;
+
+static Watch watches[WATCHDOG_MAX_TASKS];
+static int watchCount = 0;
+static uint32_t (*getTime)() = NULL; // Set by watchdog_init; nothing is checked before
+static uint32_t lastCheck = 0;
+static volatile uint32_t graceEnd = 0; // Deadlines count from here if it is later than the last run
+static int wasReset = 0;
+
+// ########################################################################################
+// Starts the WDT. Once started it can't be stopped until the next reset.
+// ########################################################################################
+void watchdog_init(uint32_t (*getTicks)()) {
+	getTime = getTicks;
+	lastCheck = getTime();
+
+	// Note why we last reset and clear it for next time
+	wasReset = (LPC_SC->RSID & RSID_WDTR) != 0;
+	LPC_SC->RSID = RSID_WDTR;
+
+	WDT_Init(WDT_CLKSRC_IRC, WDT_MODE_RESET);
+	WDT_Start(WATCHDOG_TIMEOUT*1000);
+}
+
+// ########################################################################################
+// Watches a task, which must run at least every deadline ms while it is on a list
+// ########################################################################################
+int watchdog_watch(Task *task, const char *name, uint32_t deadline) {
+	if (watchCount >= WATCHDOG_MAX_TASKS)
+		return 0;
+	watches[watchCount].task = task;
+	watches[watchCount].name = name;
+	watches[watchCount].deadline = deadline;
+	watchCount++;
+	return 1;
+}
+
+// ########################################################################################
+// Returns the name of a watched task, or NULL
+// ########################################################################################
+const char *watchdog_getName(uint32_t watch) {
+	return watch < (uint32_t)watchCount ? watches[watch].name : NULL;
+}
+
+// ########################################################################################
+// Gives every deadline time ms more, for main loop work that is slow on purpose
+// ########################################################################################
+void watchdog_extend(uint32_t time) {
+	uint32_t end = getTime()+time;
+	if ((int32_t)(end-graceEnd) > 0)
+		graceEnd = end;
+}
+
+// ########################################################################################
+// Interrupt (SysTick): checks the deadlines and feeds the WDT if none are missed
+// ########################################################################################
+void watchdog_check() {
+	uint32_t now, since;
+	int watch;
+	Task *task;
+
+	if (getTime == NULL)
+		return;
+	now = getTime();
+	if (now-lastCheck < WATCHDOG_CHECK_TIME)
+		return;
+	lastCheck = now;
+
+	for (watch=0;watch<watchCount;watch++) {
+		task = watches[watch].task;
+		if (!task->isScheduled || (task->repeatCount != -1 && task->runCount >= task->repeatCount))
+			continue;
+		since = task->lastRun;
+		if ((int32_t)(graceEnd-since) > 0)
+			since = graceEnd;
+		if ((int32_t)(now-since) > (int32_t)watches[watch].deadline)
+			crash_watchdog(watch);
+	}
+	WDT_Feed();
+}
+
+// ########################################################################################
+// Returns 1 if the WDT caused the last reset
+// ########################################################################################
+int watchdog_wasReset() {
+	return wasReset;
+}
@@ -0,0 +1,33 @@
+/*****************************************************************************
+ * Watchdog supervisor header file
+ * (feeds the WDT only while every watched task keeps running on time)
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include "task.h"
+#include <stdint.h>
+
+#define WATCHDOG_TIMEOUT 1000 // ms without a feed before the WDT resets the chip
+#define WATCHDOG_CHECK_TIME 50 // ms between deadline checks
+#define WATCHDOG_MAX_TASKS 8
+
+void watchdog_init(uint32_t (*getTicks)());
+
+int watchdog_watch(Task *task, const char *name, uint32_t deadline);
+
+const char *watchdog_getName(uint32_t watch);
+
+void watchdog_extend(uint32_t time);
+
+void watchdog_check();
+
+int watchdog_wasReset();
+
+#endif /* WATCHDOG_H_ */
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ * Host test header file
+ * (checks for the tests in test/, which build with the host compiler)
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+// Records a failure with where it happened if condition is false
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+// Like CHECK(actual == expected), printing both values
+#define CHECK_EQUAL(actual, expected) \
+	do { \
+		long long checkActual = (actual), checkExpected = (expected); \
+		if (checkActual != checkExpected) { \
+			printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, \
+					checkActual, checkExpected); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+// Ends main: prints the result and returns the exit code
+#define CHECK_DONE() \
+	do { \
+		printf("%s: %s\n", __FILE__, checkFailures ? "FAILED" : "passed"); \
+		return checkFailures ? 1 : 0; \
+	} while (0)
+
+#endif /* CHECK_H_ */
@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * Command protocol tests
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "check.h"
+#include "command.h"
+#include <string.h>
+
+static char output[256]; // Everything sent home
+static char lastArgs[CMD_MAX_LENGTH+1];
+static int keys = 0; // Characters left for the keystroke menus
+
+// ########################################################################################
+// Stands in for the terminal, keeping what was written
+// ########################################################################################
+void term_write(char *str) {
+	strncat(output, str, sizeof(output)-strlen(output)-1);
+}
+
+static int echoCommand(char *args, char *reply) {
+	strcpy(lastArgs, args);
+	strcpy(reply, args);
+	return CMD_OK;
+}
+
+static const Command commands[] = {
+	{"ECHO", &echoCommand},
+};
+
+// ########################################################################################
+// Feeds a string to the parser as the UART interrupt does, counting stray keystrokes
+// ########################################################################################
+static void receive(const char *str) {
+	while (*str != '\0') {
+		if (!cmd_receive(*str++))
+			keys++;
+	}
+}
+
+// ########################################################################################
+// Starts each test with an empty queue and no output
+// ########################################################################################
+static void reset() {
+	cmd_init(commands, sizeof(commands)/sizeof(commands[0]));
+	output[0] = '\0';
+	lastArgs[0] = '\0';
+	keys = 0;
+}
+
+// ########################################################################################
+// A frame ending in CR runs and is answered with its id
+// ########################################################################################
+static void testFrame() {
+	reset();
+	receive("#7 ECHO HI\r");
+	cmd_poll();
+	CHECK(strcmp(lastArgs, "HI") == 0);
+	CHECK(strcmp(output, "!7 OK HI\r\n") == 0);
+	CHECK_EQUAL(keys, 0);
+}
+
+// ########################################################################################
+// CRLF ends one frame, and the LF does not reach the keystroke menus
+// ########################################################################################
+static void testCrLf() {
+	reset();
+	receive("#1 ECHO A\r\n#2 ECHO B\r\n");
+	cmd_poll();
+	CHECK(strcmp(output, "!1 OK A\r\n!2 OK B\r\n") == 0);
+	CHECK_EQUAL(keys, 0);
+
+	// Only one LF belongs to the frame, and a lone LF still ends one
+	reset();
+	receive("#3 ECHO C\r\n\n#4 ECHO D\n");
+	cmd_poll();
+	CHECK(strcmp(output, "!3 OK C\r\n!4 OK D\r\n") == 0);
+	CHECK_EQUAL(keys, 1);
+
+	// Keystrokes after a CR are left alone
+	reset();
+	receive("#5 ECHO E\rx");
+	cmd_poll();
+	CHECK(strcmp(output, "!5 OK E\r\n") == 0);
+	CHECK_EQUAL(keys, 1);
+}
+
+// ########################################################################################
+// Unknown names and long lines are answered with an error
+// ########################################################################################
+static void testErrors() {
+	reset();
+	receive("#8 NOPE\r\n#9 ECHO 0123456789012345678901234567890123456789X\r\n");
+	cmd_poll();
+	CHECK(strcmp(output, "!8 ERR UNKNOWN\r\n!9 ERR TOO_LONG\r\n") == 0);
+	CHECK_EQUAL(keys, 0);
+}
+
+int main() {
+	testFrame();
+	testCrLf();
+	testErrors();
+	CHECK_DONE();
+}
@@ -0,0 +1,151 @@
+/*****************************************************************************
+ * Fixed point tests
+ *
+ * Checks the fixed point helpers against the same sums done in floating
+ * point on the host.
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "check.h"
+#include "fixed.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// ########################################################################################
+// Returns a pseudo random number from -range to range, the same on every run
+// ########################################################################################
+static int32_t randomIn(int32_t range) {
+	return (int32_t)(rand() % (2*range+1)) - range;
+}
+
+// ########################################################################################
+// Rounded division matches round(), halves going away from zero
+// ########################################################################################
+static void testDivRound() {
+	int count;
+	int32_t num, den;
+
+	CHECK_EQUAL(fixed_divRound(7, 2), 4);
+	CHECK_EQUAL(fixed_divRound(-7, 2), -4);
+	CHECK_EQUAL(fixed_divRound(5, -3), -2);
+	CHECK_EQUAL(fixed_divRound(-5, -3), 2);
+	CHECK_EQUAL(fixed_divRound(0, 9), 0);
+	for (count=0;count<10000;count++) {
+		num = randomIn(200000);
+		den = randomIn(1000);
+		if (den == 0)
+			continue;
+		CHECK_EQUAL(fixed_divRound(num, den), (int32_t)round((double)num/den));
+	}
+}
+
+// ########################################################################################
+// Conversions to and from Q16.16, and multiplication, match doubles to the nearest step
+// ########################################################################################
+static void testConversions() {
+	int count;
+	int32_t num, den;
+	q16_t a, b;
+
+	CHECK_EQUAL(fixed_fromRatio(1, 3), 21845);
+	CHECK_EQUAL(fixed_toInt(fixed_fromRatio(-3, 2)), -2);
+	CHECK_EQUAL(fixed_toInt(Q16_FROM_INT(-32768)), -32768);
+	for (count=0;count<10000;count++) {
+		num = randomIn(30000);
+		den = randomIn(30000);
+		if (den == 0)
+			continue;
+		CHECK_EQUAL(fixed_fromRatio(num, den), (q16_t)round((double)num*Q16_ONE/den));
+
+		a = randomIn(100*Q16_ONE);
+		b = randomIn(100*Q16_ONE);
+		CHECK_EQUAL(fixed_toInt(a), (int32_t)round((double)a/Q16_ONE));
+		CHECK_EQUAL(fixed_mul(a, b), (q16_t)round((double)a*b/Q16_ONE));
+	}
+}
+
+// ########################################################################################
+// Calibration scale matches value*gain+offset in doubles
+// ########################################################################################
+static void testScale() {
+	int count;
+	int32_t value, offset;
+	q16_t gain;
+
+	CHECK_EQUAL(fixed_scale(-100, fixed_fromRatio(11, 10), 5), -105);
+	for (count=0;count<10000;count++) {
+		value = randomIn(30000);
+		gain = randomIn(4*Q16_ONE);
+		offset = randomIn(1000);
+		CHECK_EQUAL(fixed_scale(value, gain, offset),
+				(int32_t)round((double)value*gain/Q16_ONE) + offset);
+	}
+}
+
+// ########################################################################################
+// Moving average stays within one count of the same filter in doubles
+// ########################################################################################
+static void testEma() {
+	FixedEma ema;
+	double reference = 0;
+	int32_t sample, average;
+	int shift, count;
+
+	for (shift=0;shift<=8;shift++) {
+		fixed_emaInit(&ema, shift);
+		for (count=0;count<5000;count++) {
+			sample = (count < 1000) ? randomIn(128) : -90;
+			average = fixed_emaUpdate(&ema, sample);
+			reference = (count == 0) ? sample : reference + (sample-reference)/(1 << shift);
+			CHECK(fabs(average-reference) <= 1.0);
+			if (shift == 0)
+				CHECK_EQUAL(average, sample);
+		}
+		// Settles on a steady input instead of stopping short of it
+		CHECK_EQUAL(fixed_emaValue(&ema), -90);
+	}
+}
+
+// ########################################################################################
+// Compares ints for qsort
+// ########################################################################################
+static int compareInts(const void *a, const void *b) {
+	int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+	return (x > y) - (x < y);
+}
+
+// ########################################################################################
+// Median matches the middle of a sorted copy, and is 0 with no samples
+// ########################################################################################
+static void testMedian() {
+	int32_t samples[FIXED_MEDIAN_MAX] = {0}, sorted[FIXED_MEDIAN_MAX];
+	int count, length, i;
+
+	CHECK_EQUAL(fixed_median(samples, 0), 0);
+	CHECK_EQUAL(fixed_median(samples, -1), 0);
+	for (count=0;count<1000;count++) {
+		length = 1 + count % FIXED_MEDIAN_MAX;
+		for (i=0;i<length;i++)
+			samples[i] = sorted[i] = randomIn(1000);
+		qsort(sorted, length, sizeof(sorted[0]), &compareInts);
+		CHECK_EQUAL(fixed_median(samples, length), sorted[(length-1)/2]);
+	}
+}
+
+// ########################################################################################
+// Main function
+// ########################################################################################
+int main() {
+	srand(2024);
+	testDivRound();
+	testConversions();
+	testScale();
+	testEma();
+	testMedian();
+	CHECK_DONE();
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * Formatting tests
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "check.h"
+#include "fmt.h"
+#include <stdint.h>
+#include <string.h>
+
+// Checks the text written and that the returned end is its '\0'
+#define CHECK_TEXT(buffer, end, expected) \
+	do { \
+		CHECK(strcmp(buffer, expected) == 0); \
+		CHECK_EQUAL(end-buffer, strlen(expected)); \
+	} while (0)
+
+// ########################################################################################
+// Whole numbers, including the ends of their ranges
+// ########################################################################################
+static void testIntegers() {
+	char out[FMT_INT_SIZE];
+	char *end;
+
+	end = fmt_uint(out, 0);
+	CHECK_TEXT(out, end, "0");
+	end = fmt_uint(out, UINT32_MAX);
+	CHECK_TEXT(out, end, "4294967295");
+	end = fmt_int(out, 0);
+	CHECK_TEXT(out, end, "0");
+	end = fmt_int(out, -7);
+	CHECK_TEXT(out, end, "-7");
+	end = fmt_int(out, INT32_MAX);
+	CHECK_TEXT(out, end, "2147483647");
+	end = fmt_int(out, INT32_MIN);
+	CHECK_TEXT(out, end, "-2147483648");
+}
+
+// ########################################################################################
+// Fixed point numbers, negative ones keeping their sign below one
+// ########################################################################################
+static void testFixed() {
+	char out[32];
+	char *end;
+
+	end = fmt_fixed(out, 0, 1);
+	CHECK_TEXT(out, end, "0.0");
+	end = fmt_fixed(out, 255, 1);
+	CHECK_TEXT(out, end, "25.5");
+	end = fmt_fixed(out, -5, 1);
+	CHECK_TEXT(out, end, "-0.5");
+	end = fmt_fixed(out, -123, 1);
+	CHECK_TEXT(out, end, "-12.3");
+	end = fmt_fixed(out, -7, 3);
+	CHECK_TEXT(out, end, "-0.007");
+	end = fmt_fixed(out, INT32_MIN, 1);
+	CHECK_TEXT(out, end, "-214748364.8");
+	end = fmt_fixed(out, 42, 0);
+	CHECK_TEXT(out, end, "42");
+
+	// Decimals past what a uint32_t scale holds are taken as 9
+	end = fmt_fixed(out, -1, 9);
+	CHECK_TEXT(out, end, "-0.000000001");
+	end = fmt_fixed(out, -1, 20);
+	CHECK_TEXT(out, end, "-0.000000001");
+}
+
+// ########################################################################################
+// Hex widths, cut to the low digits and clamped to a whole uint32_t
+// ########################################################################################
+static void testHex() {
+	char out[16];
+	char *end;
+
+	end = fmt_hex(out, 0, 2);
+	CHECK_TEXT(out, end, "00");
+	end = fmt_hex(out, 0xAB, 1);
+	CHECK_TEXT(out, end, "B");
+	end = fmt_hex(out, 0x1F, 4);
+	CHECK_TEXT(out, end, "001F");
+	end = fmt_hex(out, 0xDEADBEEF, 8);
+	CHECK_TEXT(out, end, "DEADBEEF");
+	end = fmt_hex(out, 0xDEADBEEF, 12);
+	CHECK_TEXT(out, end, "DEADBEEF");
+	end = fmt_hex(out, 0x12, 0);
+	CHECK_TEXT(out, end, "");
+}
+
+// ########################################################################################
+// Padding to a width, and strings and characters joined together
+// ########################################################################################
+static void testPadAndJoin() {
+	char out[32];
+	char *end;
+
+	end = fmt_pad(fmt_int(out, -12), out, 6);
+	CHECK_TEXT(out, end, "-12   ");
+	end = fmt_pad(fmt_str(out, "TOO LONG"), out, 3);
+	CHECK_TEXT(out, end, "TOO LONG");
+	end = fmt_pad(out, out, 0);
+	CHECK_TEXT(out, end, "");
+
+	end = fmt_uint(fmt_char(fmt_str(out, "L"), '='), 120);
+	CHECK_TEXT(out, end, "L=120");
+}
+
+int main() {
+	testIntegers();
+	testFixed();
+	testHex();
+	testPadAndJoin();
+	CHECK_DONE();
+}
@@ -0,0 +1,135 @@
+/*****************************************************************************
+ * Scheduler tests
+ *
+ * Author: Chang Chu-Ming
+ *         Terry Chua
+ *
+ * Date: 25/10/2015
+ *
+ ******************************************************************************/
+#include "check.h"
+#include "task.h"
+
+static int runs = 0;
+
+static void countRun() {
+	runs++;
+}
+
+// ########################################################################################
+// Runs one tick of a list, as the TIMER0 interrupt and the main loop do
+// ########################################################################################
+static void tick(TaskList *taskList) {
+	removeFinishedTasks(taskList);
+	checkAndRunTasks(taskList);
+}
+
+// ########################################################################################
+// A task runs every interval and stops after its repeat count
+// ########################################################################################
+static void testRepeats() {
+	static TaskList taskList;
+	static Task task = TASK_INIT(&countRun, 2*TASK_TICK_MILLIS, 3);
+	int count;
+
+	runs = 0;
+	addTask(&taskList, &task);
+	for (count=0;count<5;count++)
+		tick(&taskList);
+	CHECK_EQUAL(runs, 2);
+	for (count=0;count<10;count++)
+		tick(&taskList);
+	CHECK_EQUAL(runs, 3);
+	CHECK_EQUAL(taskList.count, 0);
+	CHECK(!task.isScheduled);
+}
+
+// ########################################################################################
+// An endless task still stops with repeatCount 0 after more runs than int16_t holds
+// ########################################################################################
+static void testStopAfterLongRun() {
+	static TaskList taskList;
+	static Task task = TASK_INIT(&countRun, TASK_TICK_MILLIS, -1);
+	long count;
+
+	runs = 0;
+	addTask(&taskList, &task);
+	for (count=0;count<40000;count++)
+		tick(&taskList);
+	CHECK_EQUAL(runs, 40000);
+
+	task.repeatCount = 0;
+	tick(&taskList);
+	tick(&taskList);
+	CHECK_EQUAL(runs, 40000);
+	CHECK_EQUAL(taskList.count, 0);
+	CHECK(!task.isScheduled);
+
+	// Starts again like the modes do
+	task.repeatCount = -1;
+	addTask(&taskList, &task);
+	tick(&taskList);
+	CHECK_EQUAL(runs, 40001);
+	CHECK_EQUAL(taskList.count, 1);
+}
+
+// ########################################################################################
+// A task stopped and started again within one tick stays on the list once
+// ########################################################################################
+static void testRestartWithinTick() {
+	static TaskList taskList;
+	static Task task = TASK_INIT(&countRun, 2*TASK_TICK_MILLIS, -1);
+	int count;
+
+	runs = 0;
+	addTask(&taskList, &task);
+	tick(&taskList);
+
+	// Stopped and started like the modes do, before the list is ticked again
+	task.repeatCount = 0;
+	task.repeatCount = -1;
+	addTask(&taskList, &task);
+	CHECK_EQUAL(taskList.count, 1);
+
+	// Interval starts again from the restart
+	tick(&taskList);
+	CHECK_EQUAL(runs, 0);
+	for (count=0;count<9;count++)
+		tick(&taskList);
+	CHECK_EQUAL(runs, 5);
+	CHECK_EQUAL(taskList.count, 1);
+
+	task.repeatCount = 0;
+	tick(&taskList);
+	CHECK_EQUAL(taskList.count, 0);
+}
+
+// ########################################################################################
+// A tick length change reworks the ticks of tasks already on a list
+// ########################################################################################
+static void testTickChange() {
+	static TaskList taskList;
+	static Task task = TASK_INIT(&countRun, 4*TASK_TICK_MILLIS, -1);
+	int count;
+
+	runs = 0;
+	addTask(&taskList, &task);
+	setTaskTick(2*TASK_TICK_MILLIS);
+	for (count=0;count<8;count++)
+		tick(&taskList);
+	CHECK_EQUAL(runs, 4);
+	setTaskTick(TASK_TICK_MILLIS);
+	task.repeatCount = 0;
+	tick(&taskList);
+}
+
+// ########################################################################################
+// Main function
+// ########################################################################################
+int main() {
+	testRepeats();
+	testStopAfterLongRun();
+	testRestartWithinTick();
+	testTickChange();
+	CHECK_DONE();
+}
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Per function size and cycle comparison between builds of the firmware.
+
+    compare_builds.py [--tools arm-none-eabi-] base.axf other.axf [other.axf ...]
+
+The first .axf is the baseline (normally the -O0 Debug build). For every
+function it prints the code size from the symbol table and a static cycle
+cost: the Cortex-M3 cycles to run each of its instructions once, loops and
+calls not followed. That is a rough guide to how heavy a function is, not a
+timing, but it is enough to see how much an ISR sheds between -O0 and -O2.
+Functions that LTO inlined or dropped show as "-". Interrupt and exception
+handlers are marked with * and listed first.
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# Cortex-M3 cycle counts (ARM DDI 0337, table 18-1), taking middle values
+# for branches and divides, whose cost depends on the operands and the pipeline
+BRANCHES = {"b", "bl", "bx", "blx", "cbz", "cbnz", "tbb", "tbh"}
+CONDITIONS = ("eq", "ne", "cs", "hs", "cc", "lo", "mi", "pl", "vs", "vc",
+              "hi", "ls", "ge", "lt", "gt", "le")
+
+
+def instruction_cycles(mnemonic, operands):
+    op = mnemonic.split(".")[0]
+    if op in ("push", "pop", "ldm", "stm", "ldmia", "stmia", "ldmdb", "stmdb", "ldmfd", "stmfd"):
+        registers = operands[operands.find("{") + 1:operands.find("}")]
+        count = 0
+        for part in registers.split(","):
+            part = part.strip()
+            if "-" in part:
+                first, last = (int(r.strip()[1:]) for r in part.split("-"))
+                count += last - first + 1
+            elif part:
+                count += 1
+        return 1 + count + (3 if op == "pop" and "pc" in registers else 0)
+    if op.startswith("ldrd") or op.startswith("strd"):
+        return 3
+    if op.startswith("ldr") or op.startswith("str"):
+        return 2
+    if op in ("sdiv", "udiv"):
+        return 7
+    if op in ("umull", "smull", "umlal", "smlal"):
+        return 4
+    if op in ("mla", "mls"):
+        return 2
+    if op in BRANCHES:
+        return 3
+    if op.startswith("b") and op[1:] in CONDITIONS:
+        return 2
+    return 1
+
+
+def function_sizes(tools, axf):
+    out = subprocess.check_output([tools + "nm", "-S", "--size-sort", axf], text=True)
+    sizes = {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "tTwW":
+            sizes[fields[3]] = int(fields[1], 16)
+    return sizes
+
+
+def function_cycles(tools, axf):
+    out = subprocess.check_output([tools + "objdump", "-d", "--no-show-raw-insn", axf], text=True)
+    cycles = {}
+    name = None
+    header = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+    instruction = re.compile(r"^\s+[0-9a-f]+:\s+(\S+)\s*(.*)$")
+    for line in out.splitlines():
+        match = header.match(line)
+        if match:
+            name = match.group(1)
+            cycles[name] = 0
+            continue
+        match = instruction.match(line)
+        if match and name is not None:
+            mnemonic = match.group(1)
+            if mnemonic.startswith(".word") or mnemonic.startswith(".short"):
+                continue  # Literal pool
+            cycles[name] += instruction_cycles(mnemonic, match.group(2))
+    return cycles
+
+
+def is_handler(name):
+    return name.endswith("_Handler") or name.endswith("_IRQHandler") or name == "ResetISR"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--tools", default="arm-none-eabi-", help="binutils prefix")
+    parser.add_argument("base")
+    parser.add_argument("others", nargs="+")
+    args = parser.parse_args()
+
+    builds = [args.base] + args.others
+    labels = [os.path.basename(os.path.dirname(os.path.abspath(axf))) or axf for axf in builds]
+    sizes = [function_sizes(args.tools, axf) for axf in builds]
+    cycles = [function_cycles(args.tools, axf) for axf in builds]
+
+    names = set()
+    for build in sizes:
+        names.update(build)
+    # Handlers first, then the biggest functions in the baseline
+    order = sorted(names, key=lambda n: (not is_handler(n), -sizes[0].get(n, 0), n))
+
+    width = max(len(n) for n in order) + 2
+    column = max(12, max(len(l) for l in labels) + 2)
+    print("%-*s" % (width, "") + "".join("%*s" % (column, l) for l in labels)
+          + "   " + "".join("%*s" % (column, l) for l in labels))
+    print("%-*s" % (width, "function") + "".join("%*s" % (column, "size") for _ in labels)
+          + "   " + "".join("%*s" % (column, "cycles") for _ in labels))
+    for name in order:
+        row = "%-*s" % (width, ("*" if is_handler(name) else " ") + name)
+        row += "".join("%*s" % (column, build[name] if name in build else "-") for build in sizes)
+        row += "   " + "".join("%*s" % (column, build[name] if name in build else "-") for build in cycles)
+        print(row)
+
+    totals = [sum(build.values()) for build in sizes]
+    handler_cycles = [sum(c for n, c in build.items() if is_handler(n)) for build in cycles]
+    print()
+    for label, total, handler in zip(labels, totals, handler_cycles):
+        print("%-*s %7d bytes of code (%3d%% of %s), handlers %6d cycles (%3d%% of %s)" % (
+            column, label, total, 100 * total // max(totals[0], 1), labels[0],
+            handler, 100 * handler // max(handler_cycles[0], 1), labels[0]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())